@@ -28,6 +28,8 @@
 #include "utility.h"
 #include "advertisement.h"
 #include "application.h"
+#include "connection_manager_internal.h"
+#include "adapter_internal.h"
 
 static const char *const TAG = "Adapter";
 static const char *const BLUEZ_DBUS = "org.bluez";
@@ -58,6 +60,7 @@ static const char *const DEVICE_PROPERTY_SERVICE_DATA = "ServiceData";
 static const char *const SIGNAL_PROPERTIES_CHANGED = "PropertiesChanged";
 
 static const guint MAC_ADDRESS_LENGTH = 17;
+static const guint DEVICES_PER_SLAB_PAGE = 32;
 
 static const char *discovery_state_names[] = {
         [BINC_DISCOVERY_STOPPED] = "stopped",
@@ -97,8 +100,10 @@ struct binc_adapter {
     RemoteCentralConnectionStateCallback centralStateCallback;
     void *user_data; // Borrowed
     GHashTable *devices_cache; // Owned
+    Slab *device_slab; // Owned
 
     Advertisement *advertisement; // Borrowed
+    ConnectionManager *connection_manager; // Owned
 };
 
 static void remove_signal_subscribers(Adapter *adapter) {
@@ -137,6 +142,11 @@ void binc_adapter_free(Adapter *adapter) {
 
     remove_signal_subscribers(adapter);
 
+    if (adapter->connection_manager != NULL) {
+        binc_connection_manager_free(adapter->connection_manager);
+        adapter->connection_manager = NULL;
+    }
+
     if (adapter->discovery_filter.services != NULL) {
         free_discovery_filter(adapter);
         adapter->discovery_filter.services = NULL;
@@ -147,6 +157,10 @@ void binc_adapter_free(Adapter *adapter) {
         adapter->devices_cache = NULL;
     }
 
+    // Devices are allocated from the slab so it must outlive the devices cache
+    binc_slab_free(adapter->device_slab);
+    adapter->device_slab = NULL;
+
     g_free((char *) adapter->path);
     adapter->path = NULL;
 
@@ -336,6 +350,7 @@ static void binc_internal_device_disappeared(__attribute__((unused)) GDBusConnec
             Device *device = g_hash_table_lookup(adapter->devices_cache, object);
             if (device != NULL) {
   	            deliver_device_removal(adapter, device);
+                binc_connection_manager_device_removed(adapter->connection_manager, device);
                 g_hash_table_remove(adapter->devices_cache, object);
             }
         }
@@ -383,6 +398,7 @@ static void binc_internal_device_appeared(__attribute__((unused)) GDBusConnectio
             g_hash_table_insert(adapter->devices_cache,
                                 g_strdup(binc_device_get_path(device)),
                                 device);
+            binc_connection_manager_device_added(adapter->connection_manager, device);
 
             if (adapter->discovery_state == BINC_DISCOVERY_STARTED && binc_device_get_connection_state(device) == BINC_DISCONNECTED) {
                 deliver_discovery_result(adapter, device);
@@ -581,9 +597,11 @@ static Adapter *binc_adapter_create(GDBusConnection *connection, const char *pat
     adapter->path = g_strdup(path);
     adapter->alias = NULL;
     adapter->discovery_filter.rssi = -255;
+    adapter->device_slab = binc_slab_create(binc_device_get_struct_size(), DEVICES_PER_SLAB_PAGE);
     adapter->devices_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                    g_free, (GDestroyNotify) binc_device_free);
     adapter->user_data = NULL;
+    adapter->connection_manager = binc_connection_manager_create(adapter);
     setup_signal_subscribers(adapter);
     return adapter;
 }
@@ -1133,7 +1151,6 @@ static void binc_internal_stop_advertising_cb(__attribute__((unused)) GObject *s
         log_error(TAG, "failed to unregister advertisement (error %d: %s)", error->code, error->message);
         g_clear_error(&error);
     } else {
-        binc_advertisement_unregister(adapter->advertisement, adapter);
         log_debug(TAG, "stopped advertising");
     }
 
@@ -1154,6 +1171,13 @@ void binc_adapter_stop_advertising(Adapter *adapter, Advertisement *advertisemen
                            -1,
                            NULL,
                            (GAsyncReadyCallback) binc_internal_stop_advertising_cb, adapter);
+
+    // Bluez doesn't call the advertisement while unregistering it, so the object can go now and the
+    // advertisement may be freed right after this call
+    binc_advertisement_unregister(advertisement, adapter);
+    if (adapter->advertisement == advertisement) {
+        adapter->advertisement = NULL;
+    }
 }
 
 static void binc_internal_register_appl_cb(__attribute__((unused)) GObject *source_object,
@@ -1247,3 +1271,13 @@ void *binc_adapter_get_user_data(const Adapter *adapter) {
     g_assert(adapter != NULL);
     return adapter->user_data;
 }
+
+ConnectionManager *binc_adapter_get_connection_manager(const Adapter *adapter) {
+    g_assert(adapter != NULL);
+    return adapter->connection_manager;
+}
+
+Slab *binc_adapter_get_device_slab(const Adapter *adapter) {
+    g_assert(adapter != NULL);
+    return adapter->device_slab;
+}
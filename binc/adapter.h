@@ -26,6 +26,7 @@
 
 #include <gio/gio.h>
 #include "forward_decl.h"
+#include "connection_manager.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -134,6 +135,11 @@ void binc_adapter_set_user_data(Adapter *adapter, void *user_data);
 
 void *binc_adapter_get_user_data(const Adapter *adapter);
 
+/**
+ * Get the connection manager of the adapter, use it to queue connections to many devices
+ */
+ConnectionManager *binc_adapter_get_connection_manager(const Adapter *adapter);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,46 @@
 
 static const char *const TAG = "Advertisement";
 
+static const char *const LE_ADVERTISEMENT_INTERFACE = "org.bluez.LEAdvertisement1";
+
+// Every change of a registered advertisement makes Bluez rebuild and reprogram the advertising data
+static const guint DEFAULT_UPDATE_INTERVAL_MS = 100;
+
+// Properties that can change while registered, the order matches the bits
+typedef enum {
+    ADV_PROP_LOCAL_NAME = 1 << 0,
+    ADV_PROP_SERVICES = 1 << 1,
+    ADV_PROP_SCAN_RESPONSE_SERVICES = 1 << 2,
+    ADV_PROP_MANUFACTURER_DATA = 1 << 3,
+    ADV_PROP_SCAN_RESPONSE_MANUFACTURER_DATA = 1 << 4,
+    ADV_PROP_SERVICE_DATA = 1 << 5,
+    ADV_PROP_SCAN_RESPONSE_SERVICE_DATA = 1 << 6,
+    ADV_PROP_MIN_INTERVAL = 1 << 7,
+    ADV_PROP_MAX_INTERVAL = 1 << 8,
+    ADV_PROP_APPEARANCE = 1 << 9,
+    ADV_PROP_DISCOVERABLE = 1 << 10,
+    ADV_PROP_TX_POWER = 1 << 11,
+    ADV_PROP_INCLUDES = 1 << 12,
+    ADV_PROP_SECONDARY_CHANNEL = 1 << 13
+} AdvertisementProperty;
+
+static const char *const property_names[] = {
+    "LocalName",
+    "ServiceUUIDs",
+    "ScanResponseServiceUUIDs",
+    "ManufacturerData",
+    "ScanResponseManufacturerData",
+    "ServiceData",
+    "ScanResponseServiceData",
+    "MinInterval",
+    "MaxInterval",
+    "Appearance",
+    "Discoverable",
+    "TxPower",
+    "Includes",
+    "SecondaryChannel"
+};
+
 struct binc_advertisement {
     char *path; // Owned
     char *local_name; // Owned
@@ -50,6 +90,14 @@ struct binc_advertisement {
     gboolean tx_power_enabled;
     GPtrArray *includes; // owned
     SecondaryChannel secondary_channel;
+    char *xml; // Owned, the XML node_info was parsed from
+    GDBusNodeInfo *node_info; // Owned, kept because the XML only changes when other properties are used
+    GDBusConnection *connection; // Borrowed, only set while registered
+    guint update_interval_ms;
+    guint update_timer_id;
+    guint changed_properties; // AdvertisementProperty bits that were not emitted yet
+    gint64 changed_since_us;
+    AdvertisementUpdateStats update_stats;
 };
 
 typedef struct binc_advertisement Advertisement;
@@ -154,7 +202,8 @@ GVariant *advertisement_get_property(GDBusConnection *connection,
         log_debug(TAG, "setting advertising MaxInterval to %dms (requires experimental if version < v5.77)", advertisement->max_interval);
         ret = g_variant_new_uint32(advertisement->max_interval);
     } else if (g_str_equal(property_name, "Appearance")) {
-        ret = g_variant_new_uint16(advertisement->appearance);
+        ret = advertisement->appearance_enabled && advertisement->appearance != 0 ?
+              g_variant_new_uint16(advertisement->appearance) : NULL;
     } else if (g_str_equal(property_name, "Discoverable")) {
         ret = g_variant_new_boolean(advertisement->general_discoverable);
     } else if (g_str_equal(property_name, "TxPower")) {
@@ -191,6 +240,98 @@ static const GDBusInterfaceVTable advertisement_method_table = {
         .get_property = advertisement_get_property
 };
 
+static void binc_internal_advertisement_emit_changes(Advertisement *advertisement) {
+    GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+    GVariantBuilder *invalidated = g_variant_builder_new(G_VARIANT_TYPE("as"));
+    for (guint i = 0; i < G_N_ELEMENTS(property_names); i++) {
+        if (!(advertisement->changed_properties & (1u << i))) continue;
+
+        GVariant *value = advertisement_get_property(advertisement->connection, NULL, advertisement->path,
+                                                     LE_ADVERTISEMENT_INTERFACE, property_names[i], NULL,
+                                                     advertisement);
+        if (value != NULL) {
+            g_variant_builder_add(builder, "{sv}", property_names[i], value);
+        } else {
+            // Bluez removes invalidated properties, otherwise it would keep the previous value
+            g_variant_builder_add(invalidated, "s", property_names[i]);
+        }
+    }
+
+    GError *error = NULL;
+    gboolean result = g_dbus_connection_emit_signal(advertisement->connection,
+                                                    NULL,
+                                                    advertisement->path,
+                                                    "org.freedesktop.DBus.Properties",
+                                                    "PropertiesChanged",
+                                                    g_variant_new("(sa{sv}as)", LE_ADVERTISEMENT_INTERFACE,
+                                                                  builder, invalidated),
+                                                    &error);
+    g_variant_builder_unref(builder);
+    g_variant_builder_unref(invalidated);
+
+    if (!result) {
+        log_debug(TAG, "failed to update advertisement: %s", error ? error->message : "unknown");
+        g_clear_error(&error);
+    }
+
+    gint64 latency = g_get_monotonic_time() - advertisement->changed_since_us;
+    AdvertisementUpdateStats *stats = &advertisement->update_stats;
+    stats->emitted++;
+    stats->last_latency_us = latency;
+    stats->max_latency_us = MAX(stats->max_latency_us, latency);
+    stats->mean_latency_us += (latency - stats->mean_latency_us) / (gint64) stats->emitted;
+
+    advertisement->changed_properties = 0;
+    advertisement->changed_since_us = 0;
+}
+
+static gboolean binc_internal_advertisement_update_timer(gpointer user_data) {
+    Advertisement *advertisement = (Advertisement *) user_data;
+
+    // Nothing changed during the last interval, so the next change can go out immediately
+    if (advertisement->changed_properties == 0) {
+        advertisement->update_timer_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    binc_internal_advertisement_emit_changes(advertisement);
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Tell Bluez about changed properties of a registered advertisement so it refreshes the advertising data in place.
+ * Changes are emitted at most once per update interval, changes within an interval are combined.
+ */
+static void binc_internal_advertisement_changed(Advertisement *advertisement, guint properties) {
+    if (advertisement->connection == NULL) return;
+
+    advertisement->update_stats.updates++;
+    if (advertisement->changed_properties != 0) {
+        advertisement->update_stats.coalesced++;
+    } else {
+        advertisement->changed_since_us = g_get_monotonic_time();
+    }
+    advertisement->changed_properties |= properties;
+
+    if (advertisement->update_timer_id == 0) {
+        binc_internal_advertisement_emit_changes(advertisement);
+        if (advertisement->update_interval_ms > 0) {
+            advertisement->update_timer_id = g_timeout_add(advertisement->update_interval_ms,
+                                                           binc_internal_advertisement_update_timer,
+                                                           advertisement);
+        }
+    }
+}
+
+static void binc_internal_advertisement_cancel_updates(Advertisement *advertisement) {
+    if (advertisement->update_timer_id != 0) {
+        g_source_remove(advertisement->update_timer_id);
+        advertisement->update_timer_id = 0;
+    }
+    advertisement->changed_properties = 0;
+    advertisement->changed_since_us = 0;
+}
+
 void binc_advertisement_register(Advertisement *advertisement, const Adapter *adapter) {
     g_assert(advertisement != NULL);
     g_assert(adapter != NULL);
@@ -273,46 +414,61 @@ void binc_advertisement_register(Advertisement *advertisement, const Adapter *ad
     g_string_append(xml_builder, "  </interface>\n"
                                  " </node>\n");
 
-    const char *final_xml = g_string_free(xml_builder, FALSE);
+    char *final_xml = g_string_free(xml_builder, FALSE);
     //log_debug(TAG, "Generated advertisement introspection XML:\n%s", final_xml);
 
     GError *error = NULL;
-    GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(final_xml, &error);
+    if (advertisement->xml == NULL || !g_str_equal(advertisement->xml, final_xml)) {
+        GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(final_xml, &error);
+        if (info == NULL) {
+            log_debug(TAG, "failed to parse generated XML for dbus node: %s", error ? error->message : "unknown");
+            if (error) g_clear_error(&error);
+            g_free(final_xml);
+            return;
+        }
 
-    if (info == NULL) {
-        log_debug(TAG, "failed to parse generated XML for dbus node: %s", error ? error->message : "unknown");
-        if (error) g_clear_error(&error);
-        g_free((gpointer)final_xml);
-        return;
+        if (advertisement->node_info != NULL) {
+            g_dbus_node_info_unref(advertisement->node_info);
+        }
+        g_free(advertisement->xml);
+        advertisement->node_info = info;
+        advertisement->xml = final_xml;
+    } else {
+        g_free(final_xml);
     }
 
     advertisement->registration_id = g_dbus_connection_register_object(
         binc_adapter_get_dbus_connection(adapter),
         advertisement->path,
-        info->interfaces[0],
+        advertisement->node_info->interfaces[0],
         &advertisement_method_table,
         advertisement, NULL, &error
     );
 
-    g_free((gpointer)final_xml);
-
     if (error != NULL) {
         log_debug(TAG, "registering advertisement failed: %s", error->message);
         g_clear_error(&error);
+        return;
     }
 
-    g_dbus_node_info_unref(info);
+    advertisement->connection = binc_adapter_get_dbus_connection(adapter);
 }
 
 void binc_advertisement_unregister(Advertisement *advertisement, const Adapter *adapter) {
     g_assert(advertisement != NULL);
     g_assert(adapter != NULL);
 
+    if (advertisement->registration_id == 0) return;
+
     gboolean result = g_dbus_connection_unregister_object(binc_adapter_get_dbus_connection(adapter),
                                                           advertisement->registration_id);
     if (!result) {
         log_debug(TAG, "failed to unregister advertisement");
     }
+
+    binc_internal_advertisement_cancel_updates(advertisement);
+    advertisement->registration_id = 0;
+    advertisement->connection = NULL;
 }
 
 static void byte_array_free(GByteArray *byteArray) { g_byte_array_free(byteArray, TRUE); }
@@ -335,6 +491,7 @@ Advertisement *binc_advertisement_create(void) {
     advertisement->tx_power = 4;
     advertisement->includes = NULL;
     advertisement->secondary_channel = BINC_SC_1M;
+    advertisement->update_interval_ms = DEFAULT_UPDATE_INTERVAL_MS;
     g_free(random_str);
     return advertisement;
 }
@@ -342,6 +499,8 @@ Advertisement *binc_advertisement_create(void) {
 void binc_advertisement_free(Advertisement *advertisement) {
     g_assert(advertisement != NULL);
 
+    binc_internal_advertisement_cancel_updates(advertisement);
+
     g_free(advertisement->path);
     advertisement->path = NULL;
 
@@ -376,6 +535,12 @@ void binc_advertisement_free(Advertisement *advertisement) {
         g_ptr_array_free(advertisement->includes, TRUE);
         advertisement->includes = NULL;
     }
+    if (advertisement->node_info != NULL) {
+        g_dbus_node_info_unref(advertisement->node_info);
+        advertisement->node_info = NULL;
+    }
+    g_free(advertisement->xml);
+    advertisement->xml = NULL;
 
     g_free(advertisement);
 }
@@ -385,6 +550,7 @@ void binc_advertisement_set_local_name(Advertisement *advertisement, const char
 
     g_free(advertisement->local_name);
     advertisement->local_name = g_strdup(local_name);
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_LOCAL_NAME);
 }
 
 const char *binc_advertisement_get_path(const Advertisement *advertisement) {
@@ -409,6 +575,7 @@ void binc_advertisement_set_services(Advertisement *advertisement, const GPtrArr
     for (guint i = 0; i < service_uuids->len; i++) {
         g_ptr_array_add(advertisement->services, g_strdup(g_ptr_array_index(service_uuids, i)));
     }
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SERVICES);
 }
 
 void binc_advertisement_set_scan_response_services(Advertisement *advertisement, const GPtrArray *service_uuids) {
@@ -423,6 +590,7 @@ void binc_advertisement_set_scan_response_services(Advertisement *advertisement,
     for (guint i = 0; i < service_uuids->len; i++) {
         g_ptr_array_add(advertisement->scan_response_services, g_strdup(g_ptr_array_index(service_uuids, i)));
     }
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SCAN_RESPONSE_SERVICES);
 }
 
 void binc_advertisement_set_service_data(Advertisement *advertisement, const char* service_uuid, const GByteArray *byteArray) {
@@ -438,6 +606,7 @@ void binc_advertisement_set_service_data(Advertisement *advertisement, const cha
     g_byte_array_append(value, byteArray->data, byteArray->len);
 
     g_hash_table_insert(advertisement->service_data, g_strdup(service_uuid), value);
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SERVICE_DATA);
 }
 
 void binc_advertisement_set_scan_response_service_data(Advertisement *advertisement, const char* service_uuid, const GByteArray *byteArray) {
@@ -453,6 +622,7 @@ void binc_advertisement_set_scan_response_service_data(Advertisement *advertisem
     g_byte_array_append(value, byteArray->data, byteArray->len);
 
     g_hash_table_insert(advertisement->scan_response_service_data, g_strdup(service_uuid), value);
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SCAN_RESPONSE_SERVICE_DATA);
 }
 
 void binc_advertisement_set_manufacturer_data(Advertisement *advertisement, guint16 manufacturer_id,
@@ -471,6 +641,7 @@ void binc_advertisement_set_manufacturer_data(Advertisement *advertisement, guin
     g_byte_array_append(value, byteArray->data, byteArray->len);
 
     g_hash_table_insert(advertisement->manufacturer_data, key, value);
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_MANUFACTURER_DATA);
 }
 
 void binc_advertisement_set_scan_response_manufacturer_data(Advertisement *advertisement, guint16 manufacturer_id, const GByteArray *byteArray) {
@@ -488,6 +659,7 @@ void binc_advertisement_set_scan_response_manufacturer_data(Advertisement *adver
     g_byte_array_append(value, byteArray->data, byteArray->len);
 
     g_hash_table_insert(advertisement->scan_response_manufacturer_data, key, value);
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SCAN_RESPONSE_MANUFACTURER_DATA);
 }
 
 void binc_advertisement_set_interval(Advertisement *advertisement, guint32 min, guint32 max) {
@@ -498,6 +670,7 @@ void binc_advertisement_set_interval(Advertisement *advertisement, guint32 min,
     advertisement->min_interval_enabled = TRUE;
     advertisement->max_interval = max;
     advertisement->max_interval_enabled = TRUE;
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_MIN_INTERVAL | ADV_PROP_MAX_INTERVAL);
 }
 
 void binc_advertisement_set_appearance(Advertisement *advertisement, guint16 appearance) {
@@ -505,6 +678,7 @@ void binc_advertisement_set_appearance(Advertisement *advertisement, guint16 app
 
     advertisement->appearance = appearance;
     advertisement->appearance_enabled = TRUE;
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_APPEARANCE);
 }
 
 guint16 binc_advertisement_get_appearance(Advertisement *advertisement) {
@@ -518,6 +692,7 @@ void binc_advertisement_set_general_discoverable(Advertisement *advertisement, g
 
     advertisement->general_discoverable = general_discoverable;
     advertisement->general_discoverable_enabled = TRUE;
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_DISCOVERABLE);
 }
 
 // The provided value must be in range [-127 to +20], where units are in dBm.
@@ -536,6 +711,7 @@ void binc_advertisement_set_tx_power(Advertisement *advertisement, gint16 tx_pow
     // Try to remove to avoid adding duplicated value
     g_ptr_array_remove(advertisement->includes, "tx-power");
     g_ptr_array_add(advertisement->includes, "tx-power");
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_TX_POWER | ADV_PROP_INCLUDES);
 }
 
 gint16 binc_advertisement_get_tx_power(Advertisement *advertisement) {
@@ -549,6 +725,7 @@ void binc_advertisement_set_secondary_channel(Advertisement *advertisement, Seco
     g_assert(secondary_channel <= BINC_SC_CODED);
 
     advertisement->secondary_channel = secondary_channel;
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_SECONDARY_CHANNEL);
 }
 
 SecondaryChannel binc_advertisement_get_secondary_channel(Advertisement *advertisement) {
@@ -566,4 +743,81 @@ void binc_advertisement_set_rsi(Advertisement *advertisement) {
     // Try to remove to avoid adding duplicated value
     g_ptr_array_remove(advertisement->includes, "rsi");
     g_ptr_array_add(advertisement->includes, "rsi");
+    binc_internal_advertisement_changed(advertisement, ADV_PROP_INCLUDES);
+}
+
+void binc_advertisement_set_update_interval(Advertisement *advertisement, guint interval_ms) {
+    g_assert(advertisement != NULL);
+
+    advertisement->update_interval_ms = interval_ms;
+}
+
+void binc_advertisement_get_update_stats(const Advertisement *advertisement, AdvertisementUpdateStats *stats) {
+    g_assert(advertisement != NULL);
+    g_assert(stats != NULL);
+
+    *stats = advertisement->update_stats;
+}
+
+static GPtrArray *copy_string_array(const GPtrArray *array) {
+    if (array == NULL) return NULL;
+
+    GPtrArray *copy = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < array->len; i++) {
+        g_ptr_array_add(copy, g_strdup(g_ptr_array_index(array, i)));
+    }
+    return copy;
+}
+
+static void copy_byte_array_table(GHashTable *destination, GHashTable *source, gboolean int_keys) {
+    g_hash_table_remove_all(destination);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, source);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        const GByteArray *byteArray = (const GByteArray *) value;
+        GByteArray *copy = g_byte_array_sized_new(byteArray->len);
+        g_byte_array_append(copy, byteArray->data, byteArray->len);
+        if (int_keys) {
+            int *manufacturer_id = g_new0 (int, 1);
+            *manufacturer_id = *(int *) key;
+            g_hash_table_insert(destination, manufacturer_id, copy);
+        } else {
+            g_hash_table_insert(destination, g_strdup(key), copy);
+        }
+    }
+}
+
+void binc_advertisement_copy_data(Advertisement *advertisement, const Advertisement *source) {
+    g_assert(advertisement != NULL);
+    g_assert(source != NULL);
+
+    g_free(advertisement->local_name);
+    advertisement->local_name = g_strdup(source->local_name);
+
+    if (advertisement->services != NULL) {
+        g_ptr_array_free(advertisement->services, TRUE);
+    }
+    advertisement->services = copy_string_array(source->services);
+
+    if (advertisement->scan_response_services != NULL) {
+        g_ptr_array_free(advertisement->scan_response_services, TRUE);
+    }
+    advertisement->scan_response_services = copy_string_array(source->scan_response_services);
+
+    copy_byte_array_table(advertisement->manufacturer_data, source->manufacturer_data, TRUE);
+    copy_byte_array_table(advertisement->scan_response_manufacturer_data, source->scan_response_manufacturer_data,
+                          TRUE);
+    copy_byte_array_table(advertisement->service_data, source->service_data, FALSE);
+    copy_byte_array_table(advertisement->scan_response_service_data, source->scan_response_service_data, FALSE);
+
+    advertisement->appearance = source->appearance;
+    advertisement->appearance_enabled = source->appearance_enabled;
+
+    binc_internal_advertisement_changed(advertisement,
+                                        ADV_PROP_LOCAL_NAME | ADV_PROP_SERVICES | ADV_PROP_SCAN_RESPONSE_SERVICES |
+                                        ADV_PROP_MANUFACTURER_DATA | ADV_PROP_SCAN_RESPONSE_MANUFACTURER_DATA |
+                                        ADV_PROP_SERVICE_DATA | ADV_PROP_SCAN_RESPONSE_SERVICE_DATA |
+                                        ADV_PROP_APPEARANCE);
 }
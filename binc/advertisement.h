@@ -37,6 +37,18 @@ typedef enum {
     BINC_SC_CODED
 } SecondaryChannel;
 
+/**
+ * Statistics of live updates of a registered advertisement
+ */
+typedef struct binc_advertisement_update_stats {
+    guint64 updates; // Setter calls while registered
+    guint64 emitted; // PropertiesChanged signals sent to Bluez
+    guint64 coalesced; // Updates combined with an earlier one that was not sent yet
+    gint64 last_latency_us; // Time from the first combined update until it was sent
+    gint64 max_latency_us;
+    gint64 mean_latency_us;
+} AdvertisementUpdateStats;
+
 Advertisement *binc_advertisement_create(void);
 
 void binc_advertisement_free(Advertisement *advertisement);
@@ -81,6 +93,23 @@ SecondaryChannel binc_advertisement_get_secondary_channel(Advertisement *adverti
 
 void binc_advertisement_set_rsi(Advertisement *advertisement);
 
+/**
+ * Set the minimum time between updates of a registered advertisement.
+ *
+ * While an advertisement is registered, the setters update it in place instead of requiring it to be stopped
+ * and started again. Changes made within one interval are sent together. Default is 100 ms, 0 sends every change.
+ */
+void binc_advertisement_set_update_interval(Advertisement *advertisement, guint interval_ms);
+
+void binc_advertisement_get_update_stats(const Advertisement *advertisement, AdvertisementUpdateStats *stats);
+
+/**
+ * Replace the advertising data (local name, service UUIDs, manufacturer data, service data and appearance)
+ * with a copy of the data of another advertisement. Interval, tx power and other settings are kept.
+ * A registered advertisement is updated in place.
+ */
+void binc_advertisement_copy_data(Advertisement *advertisement, const Advertisement *source);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,414 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "advertising_scheduler.h"
+#include "adapter.h"
+#include "advertisement.h"
+#include "logger.h"
+
+static const char *const TAG = "AdvertisingScheduler";
+
+static const guint DEFAULT_SLOT_DURATION_MS = 250;
+static const guint32 DEFAULT_INTERVAL_MS = 100;
+
+typedef struct binc_advertising_set {
+    Advertisement *advertisement; // Borrowed
+    guint weight;
+    gint64 current_weight;
+    gboolean on_air;
+    gint64 on_air_since;
+    guint64 activations;
+    gint64 on_air_us;
+} AdvertisingSet;
+
+typedef struct binc_advertising_slot {
+    Advertisement *carrier; // Owned, registered with Bluez
+    AdvertisingSet *set; // Borrowed, NULL when the slot is empty
+} AdvertisingSlot;
+
+struct binc_advertising_scheduler {
+    Adapter *adapter; // Borrowed
+    GPtrArray *sets; // Owned
+    GPtrArray *slots; // Owned
+    GCancellable *cancellable; // Owned, cancels reading SupportedInstances
+    guint slot_duration_ms;
+    guint32 interval_ms;
+    guint max_slots;
+    gboolean running;
+    guint rotation_timer;
+    gint64 started_us; // Start of the current run, 0 when stopped
+    gint64 elapsed_us; // Duration of the previous runs
+};
+
+static void binc_advertising_slot_free(AdvertisingSlot *slot) {
+    g_assert(slot != NULL);
+
+    binc_advertisement_free(slot->carrier);
+    slot->carrier = NULL;
+    slot->set = NULL;
+    g_free(slot);
+}
+
+AdvertisingScheduler *binc_advertising_scheduler_create(Adapter *adapter) {
+    g_assert(adapter != NULL);
+
+    AdvertisingScheduler *scheduler = g_new0(AdvertisingScheduler, 1);
+    scheduler->adapter = adapter;
+    scheduler->sets = g_ptr_array_new_with_free_func(g_free);
+    scheduler->slots = g_ptr_array_new_with_free_func((GDestroyNotify) binc_advertising_slot_free);
+    scheduler->slot_duration_ms = DEFAULT_SLOT_DURATION_MS;
+    scheduler->interval_ms = DEFAULT_INTERVAL_MS;
+    return scheduler;
+}
+
+void binc_advertising_scheduler_free(AdvertisingScheduler *scheduler) {
+    g_assert(scheduler != NULL);
+
+    binc_advertising_scheduler_stop(scheduler);
+
+    g_ptr_array_free(scheduler->slots, TRUE);
+    scheduler->slots = NULL;
+    g_ptr_array_free(scheduler->sets, TRUE);
+    scheduler->sets = NULL;
+    scheduler->adapter = NULL;
+    g_free(scheduler);
+}
+
+static AdvertisingSet *binc_internal_find_set(const AdvertisingScheduler *scheduler,
+                                              const Advertisement *advertisement) {
+    for (guint i = 0; i < scheduler->sets->len; i++) {
+        AdvertisingSet *set = g_ptr_array_index(scheduler->sets, i);
+        if (set->advertisement == advertisement) return set;
+    }
+    return NULL;
+}
+
+static void binc_internal_set_off_air(AdvertisingSet *set, gint64 now) {
+    if (!set->on_air) return;
+
+    set->on_air = FALSE;
+    set->on_air_us += now - set->on_air_since;
+}
+
+/*
+ * Smooth weighted round robin: every candidate gains its weight, the one with the most is picked and
+ * pays back the total. This spreads the turns of heavy advertisements evenly instead of bunching them.
+ */
+static AdvertisingSet *binc_internal_pick_next(const AdvertisingScheduler *scheduler, GPtrArray *picked) {
+    AdvertisingSet *best = NULL;
+    gint64 total = 0;
+    for (guint i = 0; i < scheduler->sets->len; i++) {
+        AdvertisingSet *set = g_ptr_array_index(scheduler->sets, i);
+        if (g_ptr_array_find(picked, set, NULL)) continue;
+
+        set->current_weight += set->weight;
+        total += set->weight;
+        if (best == NULL || set->current_weight > best->current_weight) {
+            best = set;
+        }
+    }
+
+    if (best != NULL) {
+        best->current_weight -= total;
+    }
+    return best;
+}
+
+static void binc_internal_rotate(AdvertisingScheduler *scheduler) {
+    gint64 now = g_get_monotonic_time();
+
+    GPtrArray *picked = g_ptr_array_sized_new(scheduler->slots->len);
+    for (guint i = 0; i < scheduler->slots->len; i++) {
+        AdvertisingSet *set = binc_internal_pick_next(scheduler, picked);
+        if (set == NULL) break;
+        g_ptr_array_add(picked, set);
+    }
+
+    // Advertisements that were picked again keep their slot so their data doesn't need to be sent again
+    for (guint i = 0; i < scheduler->slots->len; i++) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i);
+        if (slot->set == NULL) continue;
+
+        if (g_ptr_array_remove(picked, slot->set)) {
+            continue;
+        }
+        binc_internal_set_off_air(slot->set, now);
+        slot->set = NULL;
+    }
+
+    for (guint i = 0; i < scheduler->slots->len && picked->len > 0; i++) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i);
+        if (slot->set != NULL) continue;
+
+        AdvertisingSet *set = g_ptr_array_remove_index(picked, 0);
+        binc_advertisement_copy_data(slot->carrier, set->advertisement);
+        slot->set = set;
+        set->on_air = TRUE;
+        set->on_air_since = now;
+        set->activations++;
+    }
+    g_ptr_array_free(picked, TRUE);
+
+    // Fewer advertisements than slots are left, so stop the carriers that would repeat removed data
+    for (guint i = scheduler->slots->len; i > 0; i--) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i - 1);
+        if (slot->set != NULL) continue;
+
+        binc_adapter_stop_advertising(scheduler->adapter, slot->carrier);
+        g_ptr_array_remove_index(scheduler->slots, i - 1);
+    }
+}
+
+static gboolean binc_internal_rotation_timer(gpointer user_data) {
+    AdvertisingScheduler *scheduler = (AdvertisingScheduler *) user_data;
+    binc_internal_rotate(scheduler);
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Register carriers until every advertisement has a slot, the controller has no instances left or max_slots is
+ * reached. Carriers released when advertisements were removed are registered again this way.
+ */
+static void binc_internal_add_slots(AdvertisingScheduler *scheduler, guint available_instances) {
+    guint wanted = scheduler->sets->len;
+    if (scheduler->max_slots > 0) {
+        wanted = MIN(wanted, scheduler->max_slots);
+    }
+
+    guint first = scheduler->slots->len;
+    if (wanted <= first) return;
+
+    guint count = MIN(wanted - first, available_instances);
+    if (count == 0) {
+        if (first == 0) {
+            log_error(TAG, "no advertising slots available");
+        }
+        return;
+    }
+
+    for (guint i = 0; i < count; i++) {
+        AdvertisingSlot *slot = g_new0(AdvertisingSlot, 1);
+        slot->carrier = binc_advertisement_create();
+        binc_advertisement_set_interval(slot->carrier, scheduler->interval_ms, scheduler->interval_ms);
+
+        // The scheduler decides when data changes, so updates don't have to be rate limited
+        binc_advertisement_set_update_interval(slot->carrier, 0);
+        g_ptr_array_add(scheduler->slots, slot);
+    }
+
+    binc_internal_rotate(scheduler);
+    for (guint i = first; i < scheduler->slots->len; i++) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i);
+        binc_adapter_start_advertising(scheduler->adapter, slot->carrier);
+    }
+
+    log_debug(TAG, "rotating %u advertisements over %u slots", scheduler->sets->len, scheduler->slots->len);
+}
+
+static void binc_internal_supported_instances_cb(GObject *source_object,
+                                                 GAsyncResult *res,
+                                                 gpointer user_data) {
+    GError *error = NULL;
+    GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+
+    // The scheduler may be gone already
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_clear_error(&error);
+        return;
+    }
+
+    AdvertisingScheduler *scheduler = (AdvertisingScheduler *) user_data;
+    g_clear_object(&scheduler->cancellable);
+
+    // Bluez reports the instances that are still available, so the carriers already registered are not included
+    guint available_instances = scheduler->slots->len == 0 ? 1 : 0;
+    if (result != NULL) {
+        GVariant *value = NULL;
+        g_variant_get(result, "(v)", &value);
+        available_instances = g_variant_get_byte(value);
+        g_variant_unref(value);
+        g_variant_unref(result);
+    } else {
+        log_error(TAG, "failed to read SupportedInstances (error %d: %s)", error->code, error->message);
+        g_clear_error(&error);
+    }
+
+    if (scheduler->rotation_timer == 0) {
+        scheduler->rotation_timer = g_timeout_add(scheduler->slot_duration_ms, binc_internal_rotation_timer,
+                                                  scheduler);
+    }
+    binc_internal_add_slots(scheduler, available_instances);
+}
+
+static void binc_internal_read_supported_instances(AdvertisingScheduler *scheduler) {
+    // A read that is still underway adds slots for the advertisements added since
+    if (scheduler->cancellable != NULL) return;
+
+    scheduler->cancellable = g_cancellable_new();
+    g_dbus_connection_call(binc_adapter_get_dbus_connection(scheduler->adapter),
+                           "org.bluez",
+                           binc_adapter_get_path(scheduler->adapter),
+                           "org.freedesktop.DBus.Properties",
+                           "Get",
+                           g_variant_new("(ss)", "org.bluez.LEAdvertisingManager1", "SupportedInstances"),
+                           G_VARIANT_TYPE("(v)"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           -1,
+                           scheduler->cancellable,
+                           (GAsyncReadyCallback) binc_internal_supported_instances_cb, scheduler);
+}
+
+void binc_advertising_scheduler_start(AdvertisingScheduler *scheduler) {
+    g_assert(scheduler != NULL);
+    g_assert(!scheduler->running);
+
+    scheduler->running = TRUE;
+    scheduler->started_us = g_get_monotonic_time();
+    binc_internal_read_supported_instances(scheduler);
+}
+
+void binc_advertising_scheduler_stop(AdvertisingScheduler *scheduler) {
+    g_assert(scheduler != NULL);
+
+    if (scheduler->running) {
+        scheduler->elapsed_us += g_get_monotonic_time() - scheduler->started_us;
+        scheduler->started_us = 0;
+    }
+    scheduler->running = FALSE;
+    if (scheduler->cancellable != NULL) {
+        g_cancellable_cancel(scheduler->cancellable);
+        g_clear_object(&scheduler->cancellable);
+    }
+
+    if (scheduler->rotation_timer != 0) {
+        g_source_remove(scheduler->rotation_timer);
+        scheduler->rotation_timer = 0;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    for (guint i = 0; i < scheduler->slots->len; i++) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i);
+        if (slot->set != NULL) {
+            binc_internal_set_off_air(slot->set, now);
+        }
+        binc_adapter_stop_advertising(scheduler->adapter, slot->carrier);
+    }
+    g_ptr_array_set_size(scheduler->slots, 0);
+}
+
+void binc_advertising_scheduler_add(AdvertisingScheduler *scheduler, Advertisement *advertisement, guint weight) {
+    g_assert(scheduler != NULL);
+    g_assert(advertisement != NULL);
+    g_assert(weight > 0);
+
+    AdvertisingSet *set = binc_internal_find_set(scheduler, advertisement);
+    if (set == NULL) {
+        set = g_new0(AdvertisingSet, 1);
+        set->advertisement = advertisement;
+        g_ptr_array_add(scheduler->sets, set);
+    }
+    set->weight = weight;
+
+    // Slots may have been released when advertisements were removed, or there were fewer advertisements at start
+    guint max_slots = scheduler->max_slots > 0 ? scheduler->max_slots : G_MAXUINT;
+    if (scheduler->running && scheduler->slots->len < MIN(scheduler->sets->len, max_slots)) {
+        binc_internal_read_supported_instances(scheduler);
+    }
+}
+
+void binc_advertising_scheduler_remove(AdvertisingScheduler *scheduler, const Advertisement *advertisement) {
+    g_assert(scheduler != NULL);
+    g_assert(advertisement != NULL);
+
+    AdvertisingSet *set = binc_internal_find_set(scheduler, advertisement);
+    if (set == NULL) return;
+
+    gboolean was_on_air = set->on_air;
+    for (guint i = 0; i < scheduler->slots->len; i++) {
+        AdvertisingSlot *slot = g_ptr_array_index(scheduler->slots, i);
+        if (slot->set == set) {
+            slot->set = NULL;
+        }
+    }
+    g_ptr_array_remove(scheduler->sets, set);
+
+    // Don't keep broadcasting data of an advertisement that may be freed now
+    if (was_on_air) {
+        binc_internal_rotate(scheduler);
+    }
+}
+
+void binc_advertising_scheduler_set_slot_duration(AdvertisingScheduler *scheduler, guint slot_duration_ms) {
+    g_assert(scheduler != NULL);
+    g_assert(slot_duration_ms > 0);
+
+    scheduler->slot_duration_ms = slot_duration_ms;
+    if (scheduler->rotation_timer != 0) {
+        g_source_remove(scheduler->rotation_timer);
+        scheduler->rotation_timer = g_timeout_add(slot_duration_ms, binc_internal_rotation_timer, scheduler);
+    }
+}
+
+void binc_advertising_scheduler_set_interval(AdvertisingScheduler *scheduler, guint32 interval_ms) {
+    g_assert(scheduler != NULL);
+    g_assert(interval_ms > 0);
+
+    scheduler->interval_ms = interval_ms;
+}
+
+void binc_advertising_scheduler_set_max_slots(AdvertisingScheduler *scheduler, guint max_slots) {
+    g_assert(scheduler != NULL);
+
+    scheduler->max_slots = max_slots;
+}
+
+guint binc_advertising_scheduler_get_slot_count(const AdvertisingScheduler *scheduler) {
+    g_assert(scheduler != NULL);
+
+    return scheduler->slots->len;
+}
+
+gboolean binc_advertising_scheduler_get_stats(const AdvertisingScheduler *scheduler,
+                                              const Advertisement *advertisement,
+                                              AdvertisingSetStats *stats) {
+    g_assert(scheduler != NULL);
+    g_assert(advertisement != NULL);
+    g_assert(stats != NULL);
+
+    const AdvertisingSet *set = binc_internal_find_set(scheduler, advertisement);
+    if (set == NULL) return FALSE;
+
+    gint64 now = g_get_monotonic_time();
+    stats->activations = set->activations;
+    stats->on_air_us = set->on_air_us + (set->on_air ? now - set->on_air_since : 0);
+    stats->duty_cycle = 0;
+    stats->broadcast_rate_hz = 0;
+
+    // Time spent stopped doesn't count, so the rates stay the same after stopping
+    gint64 elapsed = scheduler->elapsed_us + (scheduler->started_us > 0 ? now - scheduler->started_us : 0);
+    if (elapsed > 0) {
+        stats->duty_cycle = (double) stats->on_air_us / (double) elapsed;
+        stats->broadcast_rate_hz = stats->duty_cycle * 1000.0 / (double) scheduler->interval_ms;
+    }
+    return TRUE;
+}
@@ -0,0 +1,112 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+#ifndef BINC_ADVERTISING_SCHEDULER_H
+#define BINC_ADVERTISING_SCHEDULER_H
+
+#include <gio/gio.h>
+#include "forward_decl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Broadcast statistics of one advertisement. The rate is an estimate based on the advertising interval
+ * of the slots, the controller may add up to 10 ms of random delay to every advertising event.
+ */
+typedef struct binc_advertising_set_stats {
+    guint64 activations; // Times the advertisement was put in a slot
+    gint64 on_air_us;
+    double duty_cycle; // Fraction of the time the scheduler was running that the advertisement was on air
+    double broadcast_rate_hz; // Estimated advertising events per second
+} AdvertisingSetStats;
+
+/**
+ * Create a scheduler that broadcasts more advertisements than the controller can advertise at the same time.
+ *
+ * The scheduler registers one advertisement per hardware slot, as reported by
+ * LEAdvertisingManager1.SupportedInstances, and rotates the added advertisements through these slots by
+ * updating the data of the registered advertisements in place.
+ */
+AdvertisingScheduler *binc_advertising_scheduler_create(Adapter *adapter);
+
+/**
+ * Stop broadcasting and free the scheduler. The added advertisements are not freed.
+ */
+void binc_advertising_scheduler_free(AdvertisingScheduler *scheduler);
+
+/**
+ * Add an advertisement to the rotation. Only its advertising data is used, see binc_advertisement_copy_data.
+ * The advertisement must not be registered itself and must stay valid until it is removed.
+ *
+ * @param weight relative share of air time, an advertisement with weight 2 is broadcast twice as often as one
+ * with weight 1
+ */
+void binc_advertising_scheduler_add(AdvertisingScheduler *scheduler, Advertisement *advertisement, guint weight);
+
+/**
+ * Remove an advertisement from the rotation. If fewer advertisements than slots remain, the unused slot stops
+ * advertising and is released. It is registered again when advertisements are added.
+ */
+void binc_advertising_scheduler_remove(AdvertisingScheduler *scheduler, const Advertisement *advertisement);
+
+/**
+ * Set how long an advertisement stays in a slot before the next one takes its place (default 250 ms)
+ */
+void binc_advertising_scheduler_set_slot_duration(AdvertisingScheduler *scheduler, guint slot_duration_ms);
+
+/**
+ * Set the advertising interval of the slots (default 100 ms). Must be called before starting.
+ */
+void binc_advertising_scheduler_set_interval(AdvertisingScheduler *scheduler, guint32 interval_ms);
+
+/**
+ * Limit the number of hardware slots used, for example to leave some for other advertisements. 0 uses all of them.
+ * Must be called before starting.
+ */
+void binc_advertising_scheduler_set_max_slots(AdvertisingScheduler *scheduler, guint max_slots);
+
+/**
+ * Start broadcasting. A slot is registered for every advertisement, as far as SupportedInstances and max_slots allow.
+ * When more advertisements are added later, SupportedInstances is read again to register more slots.
+ */
+void binc_advertising_scheduler_start(AdvertisingScheduler *scheduler);
+
+void binc_advertising_scheduler_stop(AdvertisingScheduler *scheduler);
+
+guint binc_advertising_scheduler_get_slot_count(const AdvertisingScheduler *scheduler);
+
+/**
+ * Get the broadcast statistics of an advertisement
+ *
+ * @return TRUE if the advertisement was added to the scheduler and stats was filled
+ */
+gboolean binc_advertising_scheduler_get_stats(const AdvertisingScheduler *scheduler,
+                                              const Advertisement *advertisement,
+                                              AdvertisingSetStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_ADVERTISING_SCHEDULER_H
@@ -0,0 +1,182 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "allocator.h"
+
+// Enough for any of the structs and strings allocated by the library
+#define BINC_ALLOCATOR_ALIGNMENT 16
+#define BINC_ALIGN(size) (((size) + (BINC_ALLOCATOR_ALIGNMENT - 1)) & ~((gsize) BINC_ALLOCATOR_ALIGNMENT - 1))
+
+typedef struct binc_arena_chunk {
+    struct binc_arena_chunk *next;
+} ArenaChunk;
+
+struct binc_arena {
+    ArenaChunk *chunks; // Owned
+    guint8 *next_free; // Borrowed
+    gsize remaining;
+    gsize chunk_size;
+    guint ref_count;
+};
+
+typedef struct binc_slab_object {
+    struct binc_slab_object *next;
+} SlabObject;
+
+struct binc_slab {
+    GSList *pages; // Owned
+    SlabObject *free_list; // Borrowed
+    gsize object_size;
+    guint objects_per_page;
+};
+
+static const gsize CHUNK_HEADER_SIZE = BINC_ALIGN(sizeof(ArenaChunk));
+
+Arena *binc_arena_create(gsize chunk_size) {
+    g_assert(chunk_size > CHUNK_HEADER_SIZE);
+
+    Arena *arena = g_new0(Arena, 1);
+    arena->chunk_size = chunk_size;
+    arena->ref_count = 1;
+    return arena;
+}
+
+Arena *binc_arena_ref(Arena *arena) {
+    g_assert(arena != NULL);
+    g_assert(arena->ref_count > 0);
+
+    arena->ref_count++;
+    return arena;
+}
+
+void binc_arena_unref(Arena *arena) {
+    g_assert(arena != NULL);
+    g_assert(arena->ref_count > 0);
+
+    arena->ref_count--;
+    if (arena->ref_count > 0) return;
+
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        g_free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->next_free = NULL;
+    arena->remaining = 0;
+    g_free(arena);
+}
+
+static guint8 *binc_arena_add_chunk(Arena *arena, gsize data_size) {
+    ArenaChunk *chunk = g_malloc0(CHUNK_HEADER_SIZE + data_size);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    return (guint8 *) chunk + CHUNK_HEADER_SIZE;
+}
+
+gpointer binc_arena_alloc0(Arena *arena, gsize size) {
+    g_assert(arena != NULL);
+    g_assert(size > 0);
+
+    size = BINC_ALIGN(size);
+    gsize data_size = arena->chunk_size - CHUNK_HEADER_SIZE;
+
+    // Big allocations get a chunk of their own so they don't waste the current chunk
+    if (size > data_size / 4) {
+        return binc_arena_add_chunk(arena, size);
+    }
+
+    if (size > arena->remaining) {
+        arena->next_free = binc_arena_add_chunk(arena, data_size);
+        arena->remaining = data_size;
+    }
+
+    gpointer result = arena->next_free;
+    arena->next_free += size;
+    arena->remaining -= size;
+    return result;
+}
+
+const char *binc_arena_strdup(Arena *arena, const char *str) {
+    g_assert(arena != NULL);
+
+    if (str == NULL) return NULL;
+
+    gsize length = strlen(str) + 1;
+    char *result = binc_arena_alloc0(arena, length);
+    memcpy(result, str, length);
+    return result;
+}
+
+Slab *binc_slab_create(gsize object_size, guint objects_per_page) {
+    g_assert(object_size > 0);
+    g_assert(objects_per_page > 0);
+
+    Slab *slab = g_new0(Slab, 1);
+    slab->object_size = BINC_ALIGN(MAX(object_size, sizeof(SlabObject)));
+    slab->objects_per_page = objects_per_page;
+    return slab;
+}
+
+void binc_slab_free(Slab *slab) {
+    g_assert(slab != NULL);
+
+    g_slist_free_full(slab->pages, g_free);
+    slab->pages = NULL;
+    slab->free_list = NULL;
+    g_free(slab);
+}
+
+static void binc_slab_add_page(Slab *slab) {
+    guint8 *page = g_malloc(slab->object_size * slab->objects_per_page);
+    slab->pages = g_slist_prepend(slab->pages, page);
+
+    for (guint i = 0; i < slab->objects_per_page; i++) {
+        SlabObject *object = (SlabObject *) (page + i * slab->object_size);
+        object->next = slab->free_list;
+        slab->free_list = object;
+    }
+}
+
+gpointer binc_slab_alloc0(Slab *slab) {
+    g_assert(slab != NULL);
+
+    if (slab->free_list == NULL) {
+        binc_slab_add_page(slab);
+    }
+
+    SlabObject *object = slab->free_list;
+    slab->free_list = object->next;
+    memset(object, 0, slab->object_size);
+    return object;
+}
+
+void binc_slab_release(Slab *slab, gpointer object) {
+    g_assert(slab != NULL);
+    g_assert(object != NULL);
+
+    SlabObject *slab_object = (SlabObject *) object;
+    slab_object->next = slab->free_list;
+    slab->free_list = slab_object;
+}
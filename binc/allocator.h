@@ -0,0 +1,70 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_ALLOCATOR_H
+#define BINC_ALLOCATOR_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Arena: bump allocator for objects that share a lifetime, like the GATT tree of a device.
+ * Individual allocations cannot be freed, everything is released at once when the last
+ * reference is dropped. Objects allocated from an arena hold a reference to it.
+ */
+typedef struct binc_arena Arena;
+
+/*
+ * Slab: allocator for many objects of the same size. Released objects are kept on a free list
+ * and reused, pages are only returned to the system by binc_slab_free.
+ */
+typedef struct binc_slab Slab;
+
+Arena *binc_arena_create(gsize chunk_size);
+
+Arena *binc_arena_ref(Arena *arena);
+
+void binc_arena_unref(Arena *arena);
+
+gpointer binc_arena_alloc0(Arena *arena, gsize size);
+
+const char *binc_arena_strdup(Arena *arena, const char *str);
+
+#define binc_arena_new0(arena, struct_type) ((struct_type *) binc_arena_alloc0((arena), sizeof(struct_type)))
+
+Slab *binc_slab_create(gsize object_size, guint objects_per_page);
+
+void binc_slab_free(Slab *slab);
+
+gpointer binc_slab_alloc0(Slab *slab);
+
+void binc_slab_release(Slab *slab, gpointer object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_ALLOCATOR_H
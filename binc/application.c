@@ -21,12 +21,20 @@
  *
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // For recvmmsg
+#endif
+
 #include "application.h"
 #include "adapter.h"
 #include "logger.h"
 #include "characteristic.h"
 #include "utility.h"
 #include <errno.h>
+#include <glib-unix.h>
+#include <gio/gunixfdlist.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #define GATT_SERV_INTERFACE "org.bluez.GattService1"
 #define GATT_CHAR_INTERFACE "org.bluez.GattCharacteristic1"
@@ -39,9 +47,49 @@ static const char *const CHARACTERISTIC_METHOD_WRITE_VALUE = "WriteValue";
 static const char *const CHARACTERISTIC_METHOD_STOP_NOTIFY = "StopNotify";
 static const char *const CHARACTERISTIC_METHOD_START_NOTIFY = "StartNotify";
 static const char *const CHARACTERISTIC_METHOD_CONFIRM = "Confirm";
+static const char *const CHARACTERISTIC_METHOD_ACQUIRE_WRITE = "AcquireWrite";
+static const char *const CHARACTERISTIC_METHOD_ACQUIRE_NOTIFY = "AcquireNotify";
 static const char *const DESCRIPTOR_METHOD_READ_VALUE = "ReadValue";
 static const char *const DESCRIPTOR_METHOD_WRITE_VALUE = "WriteValue";
 
+// Long writes are reassembled in a buffer of this size unless the application sets another limit
+static const guint DEFAULT_MAX_LONG_WRITE_LENGTH = 4096;
+
+// A long write that ends with a full fragment is completed when no fragment arrives within this time
+static const guint LONG_WRITE_TIMEOUT_MS = 250;
+
+// Size of the header of an ATT Prepare Write Request, so a full fragment holds mtu - 5 bytes
+static const guint16 PREPARE_WRITE_HEADER_SIZE = 5;
+
+// Write type Bluez uses for the writes it executes from the prepare queue of a long write
+static const char *const WRITE_TYPE_RELIABLE = "reliable";
+
+// Notifications kept while an acquired notify socket is not writable
+static const guint NOTIFY_BACKLOG_LIMIT = 64;
+
+// Packets read from an acquired write socket with one recvmmsg call
+#define WRITE_BATCH_SIZE 16
+
+#define MAX_ATTRIBUTE_LENGTH 512
+
+// Indications kept while waiting for the previous one to be confirmed
+static const guint INDICATION_QUEUE_LIMIT = 64;
+
+// An indication that is not confirmed within this time is considered lost and the next one is sent
+static const guint DEFAULT_CONFIRM_TIMEOUT_MS = 2000;
+
+static const guint INDICATE_PROPERTIES = GATT_CHR_PROP_INDICATE | GATT_CHR_PROP_ENCRYPT_INDICATE |
+                                         GATT_CHR_PROP_ENCRYPT_AUTH_INDICATE | GATT_CHR_PROP_SECURE_INDICATE;
+
+static const guint NOTIFY_PROPERTIES = GATT_CHR_PROP_NOTIFY | GATT_CHR_PROP_ENCRYPT_NOTIFY |
+                                       GATT_CHR_PROP_ENCRYPT_AUTH_NOTIFY | GATT_CHR_PROP_SECURE_NOTIFY;
+
+// Async read/write requests that are not completed within this time are answered with an error
+static const guint DEFAULT_REQUEST_TIMEOUT_MS = 5000;
+
+// Centrals with a private address show up under new addresses, so the MTU table is cleared when it gets this big
+static const guint MAX_KNOWN_CENTRALS = 64;
+
 static const gchar object_manager_xml[] =
         "<node name='/'>"
         "  <interface name='org.freedesktop.DBus.ObjectManager'>"
@@ -76,12 +124,24 @@ static const gchar characteristic_xml[] =
         "        <method name='StartNotify'/>"
         "        <method name='StopNotify' />"
         "        <method name='Confirm' />"
+        "        <method name='AcquireWrite'>"
+        "               <arg type='a{sv}' name='options' direction='in' />"
+        "               <arg type='h' name='fd' direction='out'/>"
+        "               <arg type='q' name='mtu' direction='out'/>"
+        "        </method>"
+        "        <method name='AcquireNotify'>"
+        "               <arg type='a{sv}' name='options' direction='in' />"
+        "               <arg type='h' name='fd' direction='out'/>"
+        "               <arg type='q' name='mtu' direction='out'/>"
+        "        </method>"
         "  </interface>"
         "  <interface name='org.freedesktop.DBus.Properties'>"
         "    <property type='s' name='UUID' access='read' />"
         "    <property type='o' name='Service' access='read' />"
         "    <property type='ay' name='Value' access='readwrite' />"
         "    <property type='b' name='Notifying' access='read' />"
+        "    <property type='b' name='WriteAcquired' access='read' />"
+        "    <property type='b' name='NotifyAcquired' access='read' />"
         "    <property type='as' name='Flags' access='read' />"
         "    <property type='ao' name='Descriptors' access='read' />"
         "  </interface>"
@@ -107,13 +167,49 @@ static const gchar descriptor_xml[] =
         "  </interface>"
         "</node>";
 
+// Introspection data is parsed once and shared by all applications
+static GDBusNodeInfo *object_manager_node_info = NULL;
+static GDBusNodeInfo *service_node_info = NULL;
+static GDBusNodeInfo *characteristic_node_info = NULL;
+static GDBusNodeInfo *descriptor_node_info = NULL;
+
+static GDBusInterfaceInfo *binc_internal_get_interface_info(GDBusNodeInfo **node_info, const gchar *xml) {
+    if (*node_info == NULL) {
+        GError *error = NULL;
+        *node_info = g_dbus_node_info_new_for_xml(xml, &error);
+        if (*node_info == NULL) {
+            log_error(TAG, "unable to parse introspection xml: %s", error != NULL ? error->message : "unknown error");
+            g_clear_error(&error);
+            return NULL;
+        }
+    }
+    return (*node_info)->interfaces[0];
+}
+
 struct binc_application {
     char *path;
     guint registration_id;
     GDBusConnection *connection;
     GHashTable *services;
+    GVariant *managed_objects; // Owned, cached GetManagedObjects reply
+    GVariant *char_interface_name; // Owned, shared by all PropertiesChanged signals
+    GVariant *no_invalidated_properties; // Owned, shared by all PropertiesChanged signals
+    GPtrArray *queued_notifications; // Owned
+    NotifyStats notify_stats;
+    GHashTable *long_writes; // Owned, address and characteristic path -> LongWrite
+    GHashTable *central_mtus; // Owned, address -> MTU reported by Bluez
+    GPtrArray *char_handles; // Owned array, borrowed characteristics indexed by handle
+    GPtrArray *desc_handles; // Owned array, borrowed descriptors indexed by handle
+    guint max_long_write_length;
     onLocalCharacteristicWrite on_char_write;
     onLocalCharacteristicRead on_char_read;
+    onLocalCharacteristicReadAsync on_char_read_async;
+    onLocalCharacteristicWriteAsync on_char_write_async;
+    GList *pending_requests; // Owned references to GattRequests that are not answered yet
+    guint request_timeout_ms;
+    onLocalCharacteristicIndicationComplete on_char_indication_complete;
+    guint confirm_timeout_ms;
+    IndicationStats indication_stats;
     onLocalCharacteristicUpdated on_char_updated;
     onLocalCharacteristicStartNotify on_char_start_notify;
     onLocalCharacteristicStopNotify on_char_stop_notify;
@@ -130,16 +226,47 @@ typedef struct binc_local_service {
     Application *application;
 } LocalService;
 
+typedef struct acquired_socket {
+    int fd; // Owned, -1 when not acquired
+    guint16 mtu;
+    char *address; // Owned
+    guint watch_id;
+    guint out_watch_id;
+    GQueue *backlog; // Owned, GBytes waiting for the socket to become writable
+    guint8 *buffer; // Owned, receive buffers for WRITE_BATCH_SIZE packets
+} AcquiredSocket;
+
+typedef struct indication_state {
+    gboolean pending; // Waiting for the Confirm of the last indication
+    gint64 sent_us;
+    guint timeout_id;
+    GQueue *queue; // Owned, GVariant values waiting for the pending indication to be confirmed
+} IndicationState;
+
+typedef struct coalesce_state {
+    guint interval_ms; // 0 when updates are not coalesced
+    guint timer_id;
+    GVariant *pending; // Owned, newest value that was not sent yet
+} CoalesceState;
+
 typedef struct local_characteristic {
     char *service_uuid;
     char *service_path;
     char *uuid;
     char *path;
     guint registration_id;
-    GByteArray *value;
+    GBytes *value; // Owned
+    GByteArray *value_array; // Owned, copy of value for the GByteArray based API, created on demand
     guint permissions;
     GList *flags;
     gboolean notifying;
+    gboolean acquire_notify;
+    gboolean acquire_write;
+    AcquiredSocket notify_socket;
+    AcquiredSocket write_socket;
+    IndicationState indication;
+    CoalesceState coalesce;
+    int handle;
     GHashTable *descriptors;
     Application *application;
 } LocalCharacteristic;
@@ -151,15 +278,61 @@ typedef struct local_descriptor {
     char *char_uuid;
     char *service_uuid;
     guint registration_id;
-    GByteArray *value;
+    GBytes *value; // Owned
     guint permissions;
     GList *flags;
+    int handle;
     Application *application;
 } LocalDescriptor;
 
+typedef struct queued_notification {
+    LocalCharacteristic *characteristic; // Borrowed
+    GBytes *value; // Owned
+} QueuedNotification;
+
+static void binc_queued_notification_free(QueuedNotification *notification) {
+    g_bytes_unref(notification->value);
+    g_free(notification);
+}
+
+typedef struct long_write {
+    Application *application; // Borrowed
+    LocalCharacteristic *characteristic; // Borrowed
+    char *key; // Owned
+    char *address; // Owned
+    guint8 *data; // Owned, preallocated to max_long_write_length
+    guint capacity;
+    guint length;
+    guint16 mtu;
+    guint timeout_id;
+} LongWrite;
+
+static void binc_long_write_free(LongWrite *longWrite) {
+    if (longWrite->timeout_id != 0) {
+        g_source_remove(longWrite->timeout_id);
+        longWrite->timeout_id = 0;
+    }
+
+    g_free(longWrite->data);
+    longWrite->data = NULL;
+    g_free(longWrite->address);
+    longWrite->address = NULL;
+    g_free(longWrite->key);
+    longWrite->key = NULL;
+    g_free(longWrite);
+}
+
+static void binc_release_handle(GPtrArray *handles, int handle, gpointer attribute) {
+    if (handles != NULL && handle >= 0 && g_ptr_array_index(handles, (guint) handle) == attribute) {
+        g_ptr_array_index(handles, (guint) handle) = NULL;
+    }
+}
+
 static void binc_local_desc_free(LocalDescriptor *localDescriptor) {
     g_assert(localDescriptor != NULL);
 
+    binc_release_handle(localDescriptor->application->desc_handles, localDescriptor->handle, localDescriptor);
+
     log_debug(TAG, "freeing descriptor %s", localDescriptor->path);
 
     if (localDescriptor->registration_id != 0) {
@@ -172,7 +345,7 @@ static void binc_local_desc_free(LocalDescriptor *localDescriptor) {
     }
 
     if (localDescriptor->value != NULL) {
-        g_byte_array_free(localDescriptor->value, TRUE);
+        g_bytes_unref(localDescriptor->value);
         localDescriptor->value = NULL;
     }
 
@@ -199,11 +372,72 @@ static void binc_local_desc_free(LocalDescriptor *localDescriptor) {
     g_free(localDescriptor);
 }
 
+static void binc_acquired_socket_close(AcquiredSocket *acquired) {
+    if (acquired->watch_id != 0) {
+        g_source_remove(acquired->watch_id);
+        acquired->watch_id = 0;
+    }
+
+    if (acquired->out_watch_id != 0) {
+        g_source_remove(acquired->out_watch_id);
+        acquired->out_watch_id = 0;
+    }
+
+    if (acquired->backlog != NULL) {
+        g_queue_free_full(acquired->backlog, (GDestroyNotify) g_bytes_unref);
+        acquired->backlog = NULL;
+    }
+
+    g_free(acquired->buffer);
+    acquired->buffer = NULL;
+    g_free(acquired->address);
+    acquired->address = NULL;
+
+    if (acquired->fd >= 0) {
+        close(acquired->fd);
+        acquired->fd = -1;
+    }
+    acquired->mtu = 0;
+}
+
+static void binc_indication_state_clear(IndicationState *indication) {
+    if (indication->timeout_id != 0) {
+        g_source_remove(indication->timeout_id);
+        indication->timeout_id = 0;
+    }
+
+    if (indication->queue != NULL) {
+        g_queue_free_full(indication->queue, (GDestroyNotify) g_variant_unref);
+        indication->queue = NULL;
+    }
+    indication->pending = FALSE;
+}
+
+static void binc_coalesce_state_clear(CoalesceState *coalesce) {
+    if (coalesce->timer_id != 0) {
+        g_source_remove(coalesce->timer_id);
+        coalesce->timer_id = 0;
+    }
+
+    if (coalesce->pending != NULL) {
+        g_variant_unref(coalesce->pending);
+        coalesce->pending = NULL;
+    }
+}
+
 static void binc_local_char_free(LocalCharacteristic *localCharacteristic) {
     g_assert(localCharacteristic != NULL);
 
     log_debug(TAG, "freeing characteristic %s", localCharacteristic->path);
 
+    binc_release_handle(localCharacteristic->application->char_handles, localCharacteristic->handle,
+                        localCharacteristic);
+
+    binc_acquired_socket_close(&localCharacteristic->notify_socket);
+    binc_acquired_socket_close(&localCharacteristic->write_socket);
+    binc_indication_state_clear(&localCharacteristic->indication);
+    binc_coalesce_state_clear(&localCharacteristic->coalesce);
+
     if (localCharacteristic->descriptors != NULL) {
         g_hash_table_destroy(localCharacteristic->descriptors);
         localCharacteristic->descriptors = NULL;
@@ -219,10 +453,15 @@ static void binc_local_char_free(LocalCharacteristic *localCharacteristic) {
     }
 
     if (localCharacteristic->value != NULL) {
-        g_byte_array_free(localCharacteristic->value, TRUE);
+        g_bytes_unref(localCharacteristic->value);
         localCharacteristic->value = NULL;
     }
 
+    if (localCharacteristic->value_array != NULL) {
+        g_byte_array_free(localCharacteristic->value_array, TRUE);
+        localCharacteristic->value_array = NULL;
+    }
+
     g_free(localCharacteristic->path);
     localCharacteristic->path = NULL;
 
@@ -271,6 +510,16 @@ void binc_local_service_free(LocalService *localService) {
     g_free(localService);
 }
 
+static void binc_internal_application_update_mtu(Application *application, const char *address, guint16 mtu) {
+    if (address == NULL || mtu == 0) return;
+
+    if (g_hash_table_size(application->central_mtus) >= MAX_KNOWN_CENTRALS &&
+        !g_hash_table_contains(application->central_mtus, address)) {
+        g_hash_table_remove_all(application->central_mtus);
+    }
+    g_hash_table_insert(application->central_mtus, g_strdup(address), GUINT_TO_POINTER(mtu));
+}
+
 typedef struct read_options {
     char *device;
     guint16 mtu;
@@ -284,7 +533,7 @@ void read_options_free(ReadOptions *options) {
     g_free(options);
 }
 
-static ReadOptions *parse_read_options(GVariant *params) {
+static ReadOptions *parse_read_options(Application *application, GVariant *params) {
     g_assert(g_str_equal(g_variant_get_type_string(params), "(a{sv})"));
     ReadOptions *options = g_new0(ReadOptions, 1);
 
@@ -309,6 +558,8 @@ static ReadOptions *parse_read_options(GVariant *params) {
     log_debug(TAG, "read with offset=%u, mtu=%u, link=%s, device=%s", (unsigned int) options->offset,
               (unsigned int) options->mtu, options->link_type, options->device);
 
+    binc_internal_application_update_mtu(application, options->device, options->mtu);
+
     return options;
 }
 
@@ -318,6 +569,7 @@ typedef struct write_options {
     guint16 mtu;
     guint16 offset;
     char *link_type;
+    gboolean prepare_authorize;
 } WriteOptions;
 
 void write_options_free(WriteOptions *options) {
@@ -327,7 +579,7 @@ void write_options_free(WriteOptions *options) {
     g_free(options);
 }
 
-static WriteOptions *parse_write_options(GVariant *optionsVariant) {
+static WriteOptions *parse_write_options(Application *application, GVariant *optionsVariant) {
     g_assert(g_str_equal(g_variant_get_type_string(optionsVariant), "a{sv}"));
     WriteOptions *options = g_new0(WriteOptions, 1);
 
@@ -346,12 +598,16 @@ static WriteOptions *parse_write_options(GVariant *optionsVariant) {
             options->device = path_to_address(g_variant_get_string(property_value, NULL));
         } else if (g_str_equal(property_name, "link")) {
             options->link_type = g_strdup(g_variant_get_string(property_value, NULL));
+        } else if (g_str_equal(property_name, "prepare-authorize")) {
+            options->prepare_authorize = g_variant_get_boolean(property_value);
         }
     }
 
     log_debug(TAG, "write with offset=%u, mtu=%u, link=%s, device=%s", (unsigned int) options->offset,
               (unsigned int) options->mtu, options->link_type, options->device);
 
+    binc_internal_application_update_mtu(application, options->device, options->mtu);
+
     return options;
 }
 
@@ -422,13 +678,6 @@ static void add_descriptors(GVariantBuilder *builder,
         GVariantBuilder *descriptors_builder = g_variant_builder_new(G_VARIANT_TYPE("a{sa{sv}}"));
         GVariantBuilder *desc_properties_builder = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
-        GByteArray *byteArray = localDescriptor->value;
-        GVariant *byteArrayVariant = NULL;
-        if (byteArray != NULL) {
-            byteArrayVariant = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byteArray->data,
-                                                         byteArray->len, sizeof(guint8));
-            g_variant_builder_add(desc_properties_builder, "{sv}", "Value", byteArrayVariant);
-        }
         g_variant_builder_add(desc_properties_builder, "{sv}", "UUID",
                               g_variant_new_string(localDescriptor->uuid));
         g_variant_builder_add(desc_properties_builder, "{sv}", "Characteristic",
@@ -457,25 +706,25 @@ static void add_characteristics(GVariantBuilder *builder, LocalService *localSer
         GVariantBuilder *characteristic_builder = g_variant_builder_new(G_VARIANT_TYPE("a{sa{sv}}"));
         GVariantBuilder *char_properties_builder = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
-        // Build characteristic properties
-        GByteArray *byteArray = localCharacteristic->value;
-        GVariant *byteArrayVariant = NULL;
-        if (byteArray != NULL) {
-            byteArrayVariant = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byteArray->data,
-                                                         byteArray->len, sizeof(guint8));
-            g_variant_builder_add(char_properties_builder, "{sv}", "Value", byteArrayVariant);
-        }
+        // Build characteristic properties. Value and Notifying are left out because the reply is cached,
+        // Bluez uses ReadValue and StartNotify/StopNotify for those.
         g_variant_builder_add(char_properties_builder, "{sv}", "UUID",
                               g_variant_new_string(localCharacteristic->uuid));
         g_variant_builder_add(char_properties_builder, "{sv}", "Service",
                               g_variant_new("o", localService->path));
         g_variant_builder_add(char_properties_builder, "{sv}", "Flags",
                               binc_local_characteristic_get_flags(localCharacteristic));
-        g_variant_builder_add(char_properties_builder, "{sv}", "Notifying",
-                              g_variant_new("b", localCharacteristic->notifying));
         g_variant_builder_add(char_properties_builder, "{sv}", "Descriptors",
                               binc_local_characteristic_get_descriptors(localCharacteristic));
 
+        // Bluez only looks at the presence of these to decide whether to use AcquireWrite/AcquireNotify
+        if (localCharacteristic->acquire_write) {
+            g_variant_builder_add(char_properties_builder, "{sv}", "WriteAcquired", g_variant_new_boolean(FALSE));
+        }
+        if (localCharacteristic->acquire_notify) {
+            g_variant_builder_add(char_properties_builder, "{sv}", "NotifyAcquired", g_variant_new_boolean(FALSE));
+        }
+
         // Add the characteristic to result
         g_variant_builder_add(characteristic_builder, "{sa{sv}}", GATT_CHAR_INTERFACE,
                               char_properties_builder);
@@ -527,14 +776,25 @@ static void binc_internal_application_method_call(GDBusConnection *conn,
     g_assert(application != NULL);
 
     if (g_str_equal(method, "GetManagedObjects")) {
-        GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a{oa{sa{sv}}}"));
-        if (application->services != NULL && g_hash_table_size(application->services) > 0) {
-            add_services(application, builder);
+        if (application->managed_objects == NULL) {
+            GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a{oa{sa{sv}}}"));
+            if (application->services != NULL && g_hash_table_size(application->services) > 0) {
+                add_services(application, builder);
+            }
+            GVariant *result = g_variant_builder_end(builder);
+            g_variant_builder_unref(builder);
+            application->managed_objects = g_variant_ref_sink(g_variant_new_tuple(&result, 1));
         }
-        GVariant *result = g_variant_builder_end(builder);
-        g_variant_builder_unref(builder);
 
-        g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&result, 1));
+        // The reply takes its own reference because the cached tuple is not floating
+        g_dbus_method_invocation_return_value(invocation, application->managed_objects);
+    }
+}
+
+static void binc_internal_application_invalidate_managed_objects(Application *application) {
+    if (application->managed_objects != NULL) {
+        g_variant_unref(application->managed_objects);
+        application->managed_objects = NULL;
     }
 }
 
@@ -546,22 +806,18 @@ void binc_application_publish(Application *application, const Adapter *adapter)
     g_assert(application != NULL);
     g_assert(adapter != NULL);
 
-    GError *error = NULL;
-    GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(object_manager_xml, &error);
-    if (error) {
-        log_debug(TAG, "Unable to create manager node: %s\n", error->message);
-        g_clear_error(&error);
-        return;
-    }
+    GDBusInterfaceInfo *interface_info = binc_internal_get_interface_info(&object_manager_node_info,
+                                                                         object_manager_xml);
+    if (interface_info == NULL) return;
 
+    GError *error = NULL;
     application->registration_id = g_dbus_connection_register_object(application->connection,
                                                                      application->path,
-                                                                     info->interfaces[0],
+                                                                     interface_info,
                                                                      &application_method_table,
                                                                      application,
                                                                      NULL,
                                                                      &error);
-    g_dbus_node_info_unref(info);
 
     if (application->registration_id == 0 && error != NULL) {
         log_debug(TAG, "failed to publish application");
@@ -572,6 +828,46 @@ void binc_application_publish(Application *application, const Adapter *adapter)
     log_debug(TAG, "successfully published application");
 }
 
+struct binc_gatt_request {
+    gint ref_count;
+    Application *application; // Borrowed
+    LocalCharacteristic *characteristic; // Borrowed
+    GDBusMethodInvocation *invocation; // Owned reference, NULL once answered or for a long write that timed out
+    gboolean answered;
+    gboolean is_write;
+    guint16 offset;
+    guint16 mtu;
+    GBytes *value; // Owned, the written value or the value to answer a read with
+    const char *error;
+    guint timeout_id;
+};
+
+static void binc_gatt_request_unref(GattRequest *request) {
+    if (!g_atomic_int_dec_and_test(&request->ref_count)) return;
+
+    if (request->value != NULL) {
+        g_bytes_unref(request->value);
+    }
+    g_free(request);
+}
+
+/*
+ * Forget an answered request and drop the reference of the application
+ */
+static void binc_internal_gatt_request_release(GattRequest *request) {
+    Application *application = request->application;
+
+    if (request->timeout_id != 0) {
+        g_source_remove(request->timeout_id);
+        request->timeout_id = 0;
+    }
+
+    // Returning a value or error consumes the reference to the invocation
+    request->invocation = NULL;
+    application->pending_requests = g_list_remove(application->pending_requests, request);
+    binc_gatt_request_unref(request);
+}
+
 Application *binc_create_application(const Adapter *adapter) {
     g_assert(adapter != NULL);
     char* random_str = random_string(4);
@@ -583,6 +879,18 @@ Application *binc_create_application(const Adapter *adapter) {
                                                   g_str_equal,
                                                   g_free,
                                                   (GDestroyNotify) binc_local_service_free);
+    application->char_interface_name = g_variant_ref_sink(g_variant_new_string(GATT_CHAR_INTERFACE));
+    application->no_invalidated_properties = g_variant_ref_sink(g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0));
+    application->queued_notifications = g_ptr_array_new_with_free_func(
+            (GDestroyNotify) binc_queued_notification_free);
+    application->long_writes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                                      (GDestroyNotify) binc_long_write_free);
+    application->max_long_write_length = DEFAULT_MAX_LONG_WRITE_LENGTH;
+    application->central_mtus = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    application->request_timeout_ms = DEFAULT_REQUEST_TIMEOUT_MS;
+    application->confirm_timeout_ms = DEFAULT_CONFIRM_TIMEOUT_MS;
+    application->char_handles = g_ptr_array_new();
+    application->desc_handles = g_ptr_array_new();
 
     binc_application_publish(application, adapter);
 
@@ -595,11 +903,49 @@ void binc_application_free(Application *application) {
 
     log_debug(TAG, "freeing application %s", application->path);
 
+    binc_internal_application_invalidate_managed_objects(application);
+
+    if (application->queued_notifications != NULL) {
+        g_ptr_array_free(application->queued_notifications, TRUE);
+        application->queued_notifications = NULL;
+    }
+
+    // Answer pending requests, the callers still hold a reference until they complete them
+    while (application->pending_requests != NULL) {
+        GattRequest *request = application->pending_requests->data;
+        if (request->invocation != NULL) {
+            g_dbus_method_invocation_return_dbus_error(request->invocation, BLUEZ_ERROR_FAILED,
+                                                       "application removed");
+        }
+        binc_internal_gatt_request_release(request);
+    }
+
+    // Pending long writes point to characteristics so they must go before the services
+    if (application->long_writes != NULL) {
+        g_hash_table_destroy(application->long_writes);
+        application->long_writes = NULL;
+    }
+
+    if (application->central_mtus != NULL) {
+        g_hash_table_destroy(application->central_mtus);
+        application->central_mtus = NULL;
+    }
+
+    g_variant_unref(application->char_interface_name);
+    application->char_interface_name = NULL;
+    g_variant_unref(application->no_invalidated_properties);
+    application->no_invalidated_properties = NULL;
+
     if (application->services != NULL) {
         g_hash_table_destroy(application->services);
         application->services = NULL;
     }
 
+    g_ptr_array_free(application->char_handles, TRUE);
+    application->char_handles = NULL;
+    g_ptr_array_free(application->desc_handles, TRUE);
+    application->desc_handles = NULL;
+
     if (application->registration_id != 0) {
         gboolean result = g_dbus_connection_unregister_object(application->connection, application->registration_id);
         if (!result) {
@@ -618,17 +964,9 @@ void binc_application_free(Application *application) {
 
 static const GDBusInterfaceVTable service_table = {};
 
-int binc_application_add_service(Application *application, const char *service_uuid) {
-    g_return_val_if_fail (application != NULL, EINVAL);
-    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
-
-    GError *error = NULL;
-    GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(service_xml, &error);
-    if (error) {
-        log_debug(TAG, "Unable to create service node: %s\n", error->message);
-        g_clear_error(&error);
-        return EINVAL;
-    }
+static LocalService *binc_internal_application_add_service(Application *application, const char *service_uuid) {
+    GDBusInterfaceInfo *interface_info = binc_internal_get_interface_info(&service_node_info, service_xml);
+    if (interface_info == NULL) return NULL;
 
     LocalService *localService = g_new0(LocalService, 1);
     localService->uuid = g_strdup(service_uuid);
@@ -643,27 +981,34 @@ int binc_application_add_service(Application *application, const char *service_u
             application->path,
             g_hash_table_size(application->services));
     g_hash_table_insert(application->services, g_strdup(service_uuid), localService);
+    binc_internal_application_invalidate_managed_objects(application);
 
+    GError *error = NULL;
     localService->registration_id = g_dbus_connection_register_object(application->connection,
                                                                       localService->path,
-                                                                      info->interfaces[0],
+                                                                      interface_info,
                                                                       &service_table,
                                                                       localService,
                                                                       NULL,
                                                                       &error);
-    g_dbus_node_info_unref(info);
 
     if (localService->registration_id == 0) {
         log_debug(TAG, "failed to publish local service");
         log_debug(TAG, "Error %s", error->message);
         g_hash_table_remove(application->services, service_uuid);
-        binc_local_service_free(localService);
         g_clear_error(&error);
-        return EINVAL;
+        return NULL;
     }
 
     log_debug(TAG, "successfully published local service %s", service_uuid);
-    return 0;
+    return localService;
+}
+
+int binc_application_add_service(Application *application, const char *service_uuid) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), -EINVAL);
+
+    return binc_internal_application_add_service(application, service_uuid) != NULL ? 0 : -EINVAL;
 }
 
 
@@ -732,58 +1077,105 @@ static GList *permissions2Flags(const guint permissions) {
     return list;
 }
 
+static GByteArray *binc_local_char_get_value_array(LocalCharacteristic *characteristic) {
+    if (characteristic->value_array == NULL && characteristic->value != NULL) {
+        gsize size = 0;
+        const guint8 *data = g_bytes_get_data(characteristic->value, &size);
+        characteristic->value_array = g_byte_array_sized_new((guint) size);
+        g_byte_array_append(characteristic->value_array, data, (guint) size);
+    }
+    return characteristic->value_array;
+}
+
+/*
+ * Takes ownership of bytes
+ */
 static int binc_characteristic_set_value(const Application *application, LocalCharacteristic *characteristic,
-                                         GByteArray *byteArray) {
+                                         GBytes *bytes) {
     g_return_val_if_fail (application != NULL, EINVAL);
     g_return_val_if_fail (characteristic != NULL, EINVAL);
-    g_return_val_if_fail (byteArray != NULL, EINVAL);
+    g_return_val_if_fail (bytes != NULL, EINVAL);
 
-    GString *byteArrayStr = g_byte_array_as_hex(byteArray);
-    log_debug(TAG, "set value <%s> to <%s>", byteArrayStr->str, characteristic->uuid);
-    g_string_free(byteArrayStr, TRUE);
+    if (log_get_level() <= LOG_DEBUG) {
+        GString *bytesStr = g_bytes_as_hex(bytes);
+        log_debug(TAG, "set value <%s> to <%s>", bytesStr->str, characteristic->uuid);
+        g_string_free(bytesStr, TRUE);
+    }
 
     if (characteristic->value != NULL) {
-        g_byte_array_free(characteristic->value, TRUE);
+        g_bytes_unref(characteristic->value);
     }
+    characteristic->value = bytes;
 
-    // Copy the byte array contents to the characteristic's value
-    GByteArray *newByteArray = g_byte_array_sized_new(byteArray->len);
-    g_byte_array_append(newByteArray, byteArray->data, byteArray->len);
-    characteristic->value = newByteArray;
+    if (characteristic->value_array != NULL) {
+        g_byte_array_free(characteristic->value_array, TRUE);
+        characteristic->value_array = NULL;
+    }
 
     if (application->on_char_updated != NULL) {
         application->on_char_updated(characteristic->application, characteristic->service_uuid,
-                                     characteristic->uuid, characteristic->value);
+                                     characteristic->uuid, binc_local_char_get_value_array(characteristic));
     }
 
     return 0;
 }
 
+/*
+ * Takes ownership of bytes
+ */
 static int binc_descriptor_set_value(const Application *application, LocalDescriptor *descriptor,
-                                     GByteArray *byteArray) {
+                                     GBytes *bytes) {
     g_return_val_if_fail (application != NULL, EINVAL);
     g_return_val_if_fail (descriptor != NULL, EINVAL);
-    g_return_val_if_fail (byteArray != NULL, EINVAL);
+    g_return_val_if_fail (bytes != NULL, EINVAL);
 
-    GString *byteArrayStr = g_byte_array_as_hex(byteArray);
-    log_debug(TAG, "set value <%s> to <%s>", byteArrayStr->str, descriptor->uuid);
-    g_string_free(byteArrayStr, TRUE);
+    if (log_get_level() <= LOG_DEBUG) {
+        GString *bytesStr = g_bytes_as_hex(bytes);
+        log_debug(TAG, "set value <%s> to <%s>", bytesStr->str, descriptor->uuid);
+        g_string_free(bytesStr, TRUE);
+    }
 
     if (descriptor->value != NULL) {
-        g_byte_array_free(descriptor->value, TRUE);
+        g_bytes_unref(descriptor->value);
+    }
+    descriptor->value = bytes;
+    return 0;
+}
+
+/*
+ * Get the part of a value that is returned for a read at the given offset, trimmed to what fits in one
+ * ATT read response (mtu - 1). The slice references the value so nothing is copied.
+ * Returns NULL if the offset is beyond the end of the value.
+ */
+static GVariant *binc_internal_read_value_slice(GBytes *value, guint16 offset, guint16 mtu) {
+    gsize size = g_bytes_get_size(value);
+    if (offset > size) {
+        return NULL;
     }
 
-    // Copy the byte array contents to the descriptor's value
-    GByteArray *newByteArray = g_byte_array_sized_new(byteArray->len);
-    g_byte_array_append(newByteArray, byteArray->data, byteArray->len);
-    descriptor->value = newByteArray;
+    gsize length = size - offset;
+    if (mtu > 1 && length > (gsize) (mtu - 1)) {
+        length = (gsize) (mtu - 1);
+    }
 
-//    if (application->on_char_updated != NULL) {
-//        application->on_char_updated(characteristic->application, characteristic->service_uuid,
-//                                     characteristic->uuid, byteArray);
-//    }
+    if (offset == 0 && length == size) {
+        return g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, value, TRUE);
+    }
 
-    return 0;
+    GBytes *slice = g_bytes_new_from_bytes(value, offset, length);
+    GVariant *result = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, slice, TRUE);
+    g_bytes_unref(slice);
+    return result;
+}
+
+static LocalCharacteristic *get_local_characteristic_by_handle(const Application *application, int handle) {
+    if (handle < 0 || (guint) handle >= application->char_handles->len) return NULL;
+    return g_ptr_array_index(application->char_handles, (guint) handle);
+}
+
+static LocalDescriptor *get_local_descriptor_by_handle(const Application *application, int handle) {
+    if (handle < 0 || (guint) handle >= application->desc_handles->len) return NULL;
+    return g_ptr_array_index(application->desc_handles, (guint) handle);
 }
 
 static LocalCharacteristic *get_local_characteristic(const Application *application, const char *service_uuid,
@@ -831,7 +1223,7 @@ static void binc_internal_descriptor_method_call(GDBusConnection *conn,
     g_assert(application != NULL);
 
     if (g_str_equal(method, DESCRIPTOR_METHOD_READ_VALUE)) {
-        ReadOptions *options = parse_read_options(params);
+        ReadOptions *options = parse_read_options(application, params);
 
         log_debug(TAG, "read descriptor <%s> by %s", localDescriptor->uuid, options->device);
 
@@ -841,30 +1233,34 @@ static void binc_internal_descriptor_method_call(GDBusConnection *conn,
                                                localDescriptor->service_uuid,
                                                localDescriptor->char_uuid, localDescriptor->uuid);
         }
-        read_options_free(options);
 
         if (result) {
+            read_options_free(options);
             g_dbus_method_invocation_return_dbus_error(invocation, result, "read descriptor error");
             log_debug(TAG, "read descriptor error");
             return;
         }
 
         if (localDescriptor->value != NULL) {
-            GVariant *resultVariant = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
-                                                                localDescriptor->value->data,
-                                                                localDescriptor->value->len,
-                                                                sizeof(guint8));
-            g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&resultVariant, 1));
+            GVariant *resultVariant = binc_internal_read_value_slice(localDescriptor->value, options->offset,
+                                                                     options->mtu);
+            if (resultVariant != NULL) {
+                g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&resultVariant, 1));
+            } else {
+                g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_INVALID_OFFSET,
+                                                           "offset beyond end of value");
+            }
         } else {
             g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_FAILED, "no value for descriptor");
         }
+        read_options_free(options);
     } else if (g_str_equal(method, DESCRIPTOR_METHOD_WRITE_VALUE)) {
         g_assert(g_str_equal(g_variant_get_type_string(params), "(aya{sv})"));
         GVariant *valueVariant, *optionsVariant;
 
         // Get the options
         g_variant_get(params, "(@ay@a{sv})", &valueVariant, &optionsVariant);
-        WriteOptions *options = parse_write_options(optionsVariant);
+        WriteOptions *options = parse_write_options(application, optionsVariant);
         g_variant_unref(optionsVariant);
 
         // Get the byte array to be written
@@ -894,7 +1290,7 @@ static void binc_internal_descriptor_method_call(GDBusConnection *conn,
             return;
         }
 
-        binc_descriptor_set_value(application, localDescriptor, byteArray);
+        binc_descriptor_set_value(application, localDescriptor, g_variant_get_data_as_bytes(valueVariant));
 
         if (byteArray != NULL) {
             g_byte_array_free(byteArray, FALSE);
@@ -910,57 +1306,66 @@ static const GDBusInterfaceVTable descriptor_table = {
         .method_call = binc_internal_descriptor_method_call,
 };
 
-int binc_application_add_descriptor(Application *application, const char *service_uuid,
-                                    const char *char_uuid, const char *desc_uuid, guint permissions) {
-    g_return_val_if_fail (application != NULL, EINVAL);
-    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
-
-    LocalCharacteristic *localCharacteristic = get_local_characteristic(application, service_uuid, char_uuid);
-    if (localCharacteristic == NULL) {
-        g_critical("characteristic %s does not exist", char_uuid);
-        return EINVAL;
-    }
-
-    GError *error = NULL;
-    GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(descriptor_xml, &error);
-    if (error) {
-        log_debug(TAG, "Unable to create descriptor node: %s\n", error->message);
-        g_clear_error(&error);
-        return EINVAL;
-    }
+static LocalDescriptor *binc_internal_application_add_descriptor(Application *application,
+                                                                 LocalCharacteristic *localCharacteristic,
+                                                                 const char *desc_uuid, guint permissions) {
+    GDBusInterfaceInfo *interface_info = binc_internal_get_interface_info(&descriptor_node_info, descriptor_xml);
+    if (interface_info == NULL) return NULL;
 
     LocalDescriptor *localDescriptor = g_new0(LocalDescriptor, 1);
     localDescriptor->uuid = g_strdup(desc_uuid);
     localDescriptor->application = application;
     localDescriptor->char_path = g_strdup(localCharacteristic->path);
-    localDescriptor->char_uuid = g_strdup(char_uuid);
-    localDescriptor->service_uuid = g_strdup(service_uuid);
+    localDescriptor->char_uuid = g_strdup(localCharacteristic->uuid);
+    localDescriptor->service_uuid = g_strdup(localCharacteristic->service_uuid);
     localDescriptor->flags = permissions2Flags(permissions);
+    localDescriptor->handle = -1;
     localDescriptor->path = g_strdup_printf("%s/desc%d",
                                             localCharacteristic->path,
                                             g_hash_table_size(localCharacteristic->descriptors));
     g_hash_table_insert(localCharacteristic->descriptors, g_strdup(desc_uuid), localDescriptor);
+    binc_internal_application_invalidate_managed_objects(application);
 
-    // Register characteristic
+    // Register descriptor
+    GError *error = NULL;
     localDescriptor->registration_id = g_dbus_connection_register_object(application->connection,
                                                                          localDescriptor->path,
-                                                                         info->interfaces[0],
+                                                                         interface_info,
                                                                          &descriptor_table,
                                                                          localDescriptor,
                                                                          NULL,
                                                                          &error);
-    g_dbus_node_info_unref(info);
 
     if (localDescriptor->registration_id == 0) {
-        log_debug(TAG, "failed to publish local characteristic");
+        log_debug(TAG, "failed to publish local descriptor");
         log_debug(TAG, "Error %s", error->message);
         g_clear_error(&error);
         g_hash_table_remove(localCharacteristic->descriptors, desc_uuid);
-        return EINVAL;
+        return NULL;
     }
 
+    localDescriptor->handle = (int) application->desc_handles->len;
+    g_ptr_array_add(application->desc_handles, localDescriptor);
+
     log_debug(TAG, "successfully published local descriptor %s", desc_uuid);
-    return 0;
+    return localDescriptor;
+}
+
+int binc_application_add_descriptor(Application *application, const char *service_uuid,
+                                    const char *char_uuid, const char *desc_uuid, guint permissions) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), -EINVAL);
+    g_return_val_if_fail (is_valid_uuid(desc_uuid), -EINVAL);
+
+    LocalCharacteristic *localCharacteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    if (localCharacteristic == NULL) {
+        g_critical("characteristic %s does not exist", char_uuid);
+        return -EINVAL;
+    }
+
+    LocalDescriptor *localDescriptor = binc_internal_application_add_descriptor(application, localCharacteristic,
+                                                                                desc_uuid, permissions);
+    return localDescriptor != NULL ? localDescriptor->handle : -EINVAL;
 }
 
 int binc_application_set_char_value(const Application *application, const char *service_uuid,
@@ -979,7 +1384,26 @@ int binc_application_set_char_value(const Application *application, const char *
         return EINVAL;
     }
 
-    return binc_characteristic_set_value(application, characteristic, byteArray);
+    return binc_characteristic_set_value(application, characteristic, g_bytes_new(byteArray->data, byteArray->len));
+}
+
+int binc_application_set_char_bytes(const Application *application, const char *service_uuid,
+                                    const char *char_uuid, GBytes *bytes) {
+
+    g_return_val_if_fail (bytes != NULL, EINVAL);
+
+    LocalCharacteristic *characteristic = NULL;
+    if (application != NULL && is_valid_uuid(service_uuid) && is_valid_uuid(char_uuid)) {
+        characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    }
+
+    if (characteristic == NULL) {
+        g_critical("%s: characteristic with uuid %s does not exist", G_STRFUNC, char_uuid);
+        g_bytes_unref(bytes);
+        return EINVAL;
+    }
+
+    return binc_characteristic_set_value(application, characteristic, bytes);
 }
 
 int binc_application_set_desc_value(const Application *application, const char *service_uuid,
@@ -998,7 +1422,26 @@ int binc_application_set_desc_value(const Application *application, const char *
         return EINVAL;
     }
 
-    return binc_descriptor_set_value(application, descriptor, byteArray);
+    return binc_descriptor_set_value(application, descriptor, g_bytes_new(byteArray->data, byteArray->len));
+}
+
+int binc_application_set_desc_bytes(const Application *application, const char *service_uuid,
+                                    const char *char_uuid, const char *desc_uuid, GBytes *bytes) {
+
+    g_return_val_if_fail (bytes != NULL, EINVAL);
+
+    LocalDescriptor *descriptor = NULL;
+    if (application != NULL && is_valid_uuid(service_uuid) && is_valid_uuid(char_uuid) && is_valid_uuid(desc_uuid)) {
+        descriptor = get_local_descriptor(application, service_uuid, char_uuid, desc_uuid);
+    }
+
+    if (descriptor == NULL) {
+        g_critical("%s: descriptor with uuid %s does not exist", G_STRFUNC, desc_uuid);
+        g_bytes_unref(bytes);
+        return EINVAL;
+    }
+
+    return binc_descriptor_set_value(application, descriptor, bytes);
 }
 
 GByteArray *binc_application_get_char_value(const Application *application, const char *service_uuid,
@@ -1012,95 +1455,746 @@ GByteArray *binc_application_get_char_value(const Application *application, cons
 
     LocalCharacteristic *characteristic = get_local_characteristic(application, service_uuid, char_uuid);
     if (characteristic != NULL) {
-        return characteristic->value;
+        return binc_local_char_get_value_array(characteristic);
     }
     return NULL;
 }
 
+GBytes *binc_application_get_char_bytes(const Application *application, const char *service_uuid,
+                                        const char *char_uuid) {
 
-static void binc_internal_characteristic_method_call(GDBusConnection *conn,
-                                                     const gchar *sender,
-                                                     const gchar *path,
-                                                     const gchar *interface,
-                                                     const gchar *method,
-                                                     GVariant *params,
-                                                     GDBusMethodInvocation *invocation,
-                                                     void *userdata) {
+    g_return_val_if_fail (application != NULL, NULL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), NULL);
+    g_return_val_if_fail (is_valid_uuid(char_uuid), NULL);
 
-    LocalCharacteristic *characteristic = (LocalCharacteristic *) userdata;
-    g_assert(characteristic != NULL);
+    LocalCharacteristic *characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    if (characteristic != NULL) {
+        return characteristic->value;
+    }
+    return NULL;
+}
 
-    Application *application = characteristic->application;
-    g_assert(application != NULL);
+int binc_application_set_char_value_by_handle(const Application *application, int handle, GByteArray *byteArray) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (byteArray != NULL, -EINVAL);
 
-    if (g_str_equal(method, CHARACTERISTIC_METHOD_READ_VALUE)) {
-        log_debug(TAG, "read <%s>", characteristic->uuid);
-        ReadOptions *options = parse_read_options(params);
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        return -EINVAL;
+    }
 
-        // Allow application to accept/reject the characteristic value before setting it
-        const char *result = NULL;
-        if (application->on_char_read != NULL) {
-            result = application->on_char_read(characteristic->application, options->device,
-                                               characteristic->service_uuid,
-                                               characteristic->uuid, options->mtu, options->offset);
-        }
-        read_options_free(options);
+    return -binc_characteristic_set_value(application, characteristic, g_bytes_new(byteArray->data, byteArray->len));
+}
 
-        if (result) {
-            g_dbus_method_invocation_return_dbus_error(invocation, result, "read characteristic error");
-            log_debug(TAG, "read characteristic error '%s'", result);
-            return;
-        }
+int binc_application_set_char_bytes_by_handle(const Application *application, int handle, GBytes *bytes) {
+    g_return_val_if_fail (bytes != NULL, -EINVAL);
 
-        // TODO deal with the offset & mtu parameter
-        if (characteristic->value != NULL) {
-            GVariant *resultVariant = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
-                                                                characteristic->value->data,
-                                                                characteristic->value->len,
-                                                                sizeof(guint8));
-            g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&resultVariant, 1));
-        } else {
-            g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_FAILED, "no value");
-        }
-    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_WRITE_VALUE)) {
-        g_assert(g_str_equal(g_variant_get_type_string(params), "(aya{sv})"));
-        GVariant *valueVariant, *optionsVariant;
+    LocalCharacteristic *characteristic = NULL;
+    if (application != NULL) {
+        characteristic = get_local_characteristic_by_handle(application, handle);
+    }
 
-        // Get the write options
-        g_variant_get(params, "(@ay@a{sv})", &valueVariant, &optionsVariant);
-        WriteOptions *options = parse_write_options(optionsVariant);
-        g_variant_unref(optionsVariant);
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        g_bytes_unref(bytes);
+        return -EINVAL;
+    }
 
-        // Get the byte array to be written
-        GByteArray *byteArray = g_variant_get_byte_array(valueVariant);
+    return -binc_characteristic_set_value(application, characteristic, bytes);
+}
 
-        log_debug(TAG, "write <%s>", characteristic->uuid);
+GByteArray *binc_application_get_char_value_by_handle(const Application *application, int handle) {
+    g_return_val_if_fail (application != NULL, NULL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic != NULL) {
+        return binc_local_char_get_value_array(characteristic);
+    }
+    return NULL;
+}
+
+GBytes *binc_application_get_char_bytes_by_handle(const Application *application, int handle) {
+    g_return_val_if_fail (application != NULL, NULL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic != NULL) {
+        return characteristic->value;
+    }
+    return NULL;
+}
+
+int binc_application_set_desc_value_by_handle(const Application *application, int handle, GByteArray *byteArray) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (byteArray != NULL, -EINVAL);
+
+    LocalDescriptor *descriptor = get_local_descriptor_by_handle(application, handle);
+    if (descriptor == NULL) {
+        g_critical("%s: invalid descriptor handle %d", G_STRFUNC, handle);
+        return -EINVAL;
+    }
+
+    return -binc_descriptor_set_value(application, descriptor, g_bytes_new(byteArray->data, byteArray->len));
+}
+
+int binc_application_set_desc_bytes_by_handle(const Application *application, int handle, GBytes *bytes) {
+    g_return_val_if_fail (bytes != NULL, -EINVAL);
+
+    LocalDescriptor *descriptor = NULL;
+    if (application != NULL) {
+        descriptor = get_local_descriptor_by_handle(application, handle);
+    }
+
+    if (descriptor == NULL) {
+        g_critical("%s: invalid descriptor handle %d", G_STRFUNC, handle);
+        g_bytes_unref(bytes);
+        return -EINVAL;
+    }
+
+    return -binc_descriptor_set_value(application, descriptor, bytes);
+}
+
+
+/*
+ * Let the application accept or reject a complete value and store it if accepted. Takes ownership of bytes.
+ */
+static const char *binc_internal_characteristic_write(Application *application, LocalCharacteristic *characteristic,
+                                                      const char *address, guint16 mtu, guint16 offset,
+                                                      GBytes *bytes) {
+    const char *result = NULL;
+    if (application->on_char_write != NULL) {
+        gsize size = 0;
+        guint8 *data = (guint8 *) g_bytes_get_data(bytes, &size);
+        GByteArray *byteArray = g_byte_array_new_take(data, size);
+        result = application->on_char_write(characteristic->application, address, characteristic->service_uuid,
+                                            characteristic->uuid, byteArray, mtu, offset);
+        g_byte_array_free(byteArray, FALSE);
+    }
+
+    if (result != NULL) {
+        g_bytes_unref(bytes);
+        return result;
+    }
+
+    binc_characteristic_set_value(application, characteristic, bytes);
+    return NULL;
+}
+
+static void binc_internal_characteristic_reply_value(GDBusMethodInvocation *invocation,
+                                                     const LocalCharacteristic *characteristic,
+                                                     guint16 offset, guint16 mtu) {
+    if (characteristic->value == NULL) {
+        g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_FAILED, "no value");
+        return;
+    }
+
+    GVariant *resultVariant = binc_internal_read_value_slice(characteristic->value, offset, mtu);
+    if (resultVariant != NULL) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new_tuple(&resultVariant, 1));
+    } else {
+        g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_INVALID_OFFSET,
+                                                   "offset beyond end of value");
+    }
+}
+
+/*
+ * Send the reply and drop the reference of the application. Only called on the main loop.
+ */
+static void binc_internal_gatt_request_answer(GattRequest *request, const char *error) {
+    if (request->answered) return;
+    request->answered = TRUE;
+
+    Application *application = request->application;
+    LocalCharacteristic *characteristic = request->characteristic;
+
+    if (error != NULL) {
+        if (request->invocation != NULL) {
+            g_dbus_method_invocation_return_dbus_error(request->invocation, error,
+                                                       request->is_write ? "write error" : "read characteristic error");
+        }
+        log_debug(TAG, "%s <%s> error '%s'", request->is_write ? "write" : "read", characteristic->uuid, error);
+    } else if (request->is_write) {
+        binc_characteristic_set_value(application, characteristic, g_bytes_ref(request->value));
+        if (request->invocation != NULL) {
+            g_dbus_method_invocation_return_value(request->invocation, g_variant_new("()"));
+        }
+    } else {
+        if (request->value != NULL) {
+            binc_characteristic_set_value(application, characteristic, g_bytes_ref(request->value));
+        }
+        binc_internal_characteristic_reply_value(request->invocation, characteristic, request->offset, request->mtu);
+    }
+
+    binc_internal_gatt_request_release(request);
+}
+
+static gboolean binc_internal_gatt_request_timeout(gpointer user_data) {
+    GattRequest *request = (GattRequest *) user_data;
+    request->timeout_id = 0;
+
+    log_debug(TAG, "request for <%s> timed out", request->characteristic->uuid);
+    binc_internal_gatt_request_answer(request, BLUEZ_ERROR_FAILED);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean binc_internal_gatt_request_complete(gpointer user_data) {
+    GattRequest *request = (GattRequest *) user_data;
+
+    // Drop the reference of the caller, the request may already be answered because of a timeout
+    binc_internal_gatt_request_answer(request, request->error);
+    binc_gatt_request_unref(request);
+    return G_SOURCE_REMOVE;
+}
+
+static GattRequest *binc_internal_gatt_request_create(Application *application, LocalCharacteristic *characteristic,
+                                                      GDBusMethodInvocation *invocation, gboolean is_write,
+                                                      guint16 offset, guint16 mtu) {
+    GattRequest *request = g_new0(GattRequest, 1);
+
+    // One reference for the application until it is answered, one for the caller until it is completed
+    request->ref_count = 2;
+    request->application = application;
+    request->characteristic = characteristic;
+    request->invocation = invocation;
+    request->is_write = is_write;
+    request->offset = offset;
+    request->mtu = mtu;
+    request->timeout_id = g_timeout_add(application->request_timeout_ms, binc_internal_gatt_request_timeout,
+                                        request);
+    application->pending_requests = g_list_prepend(application->pending_requests, request);
+    return request;
+}
+
+void binc_gatt_request_accept(GattRequest *request, GBytes *value) {
+    g_assert(request != NULL);
+
+    // The written value is stored, so a value passed for a write is only released
+    if (value != NULL && request->is_write) {
+        g_bytes_unref(value);
+    } else if (value != NULL) {
+        if (request->value != NULL) {
+            g_bytes_unref(request->value);
+        }
+        request->value = value;
+    }
+    g_main_context_invoke(NULL, binc_internal_gatt_request_complete, request);
+}
+
+void binc_gatt_request_reject(GattRequest *request, const char *error) {
+    g_assert(request != NULL);
+    g_assert(error != NULL);
+
+    request->error = error;
+    g_main_context_invoke(NULL, binc_internal_gatt_request_complete, request);
+}
+
+static void binc_internal_write_reply(GDBusMethodInvocation *invocation, const char *result) {
+    if (result) {
+        g_dbus_method_invocation_return_dbus_error(invocation, result, "write error");
+        log_debug(TAG, "write error");
+        return;
+    }
+
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
+}
+
+/*
+ * Hand a reassembled long write to the application and answer the last fragment, if there is one.
+ * The stored value is only replaced if it is accepted.
+ */
+static void binc_internal_long_write_finish(LongWrite *longWrite, GDBusMethodInvocation *invocation) {
+    Application *application = longWrite->application;
+    LocalCharacteristic *characteristic = longWrite->characteristic;
+
+    log_debug(TAG, "long write of %u bytes to <%s> by %s complete", longWrite->length, characteristic->uuid,
+              longWrite->address);
+
+    GBytes *bytes = g_bytes_new_take(g_realloc(longWrite->data, longWrite->length), longWrite->length);
+    longWrite->data = NULL;
+
+    if (application->on_char_write_async != NULL) {
+        GattRequest *request = binc_internal_gatt_request_create(application, characteristic, invocation, TRUE, 0,
+                                                                 longWrite->mtu);
+        request->value = bytes;
+        gsize size = 0;
+        guint8 *data = (guint8 *) g_bytes_get_data(bytes, &size);
+        GByteArray *byteArray = g_byte_array_new_take(data, size);
+        application->on_char_write_async(characteristic->application, longWrite->address,
+                                         characteristic->service_uuid, characteristic->uuid, byteArray,
+                                         longWrite->mtu, 0, request);
+        g_byte_array_free(byteArray, FALSE);
+        g_hash_table_remove(application->long_writes, longWrite->key);
+        return;
+    }
+
+    const char *result = binc_internal_characteristic_write(application, characteristic, longWrite->address,
+                                                            longWrite->mtu, 0, bytes);
+    g_hash_table_remove(application->long_writes, longWrite->key);
+
+    // Without a fragment to answer the Execute Write is already answered, so a rejection can only be logged
+    if (invocation != NULL) {
+        binc_internal_write_reply(invocation, result);
+    } else if (result != NULL) {
+        log_debug(TAG, "long write rejected '%s'", result);
+    }
+}
+
+static gboolean binc_internal_long_write_timeout(gpointer user_data) {
+    LongWrite *longWrite = (LongWrite *) user_data;
+    longWrite->timeout_id = 0;
+
+    binc_internal_long_write_finish(longWrite, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean binc_internal_is_long_write(const WriteOptions *options) {
+    if (options->offset > 0) return TRUE;
+    return options->write_type != NULL && g_str_equal(options->write_type, WRITE_TYPE_RELIABLE);
+}
+
+/*
+ * Write a fragment of a long write in place, in a buffer per central and characteristic.
+ *
+ * Bluez answers the Execute Write of the central only after all queued fragments are written, so acknowledging a
+ * fragment does not acknowledge the write. Bluez does not tell when the last fragment is written though. A fragment
+ * that does not exactly fill a Prepare Write Request is taken as the last one, and Bluez merges consecutive fragments
+ * so the complete value often arrives at once. The application accepts or rejects the value before that fragment is
+ * answered, also when it uses the async write callback. A long write that ends with a full fragment is completed
+ * when no fragment arrives in time.
+ */
+static void binc_internal_long_write_add(Application *application, LocalCharacteristic *characteristic,
+                                         const WriteOptions *options, GVariant *valueVariant,
+                                         GDBusMethodInvocation *invocation) {
+    gsize size = 0;
+    const guint8 *data = g_variant_get_fixed_array(valueVariant, &size, sizeof(guint8));
+    const char *address = options->device != NULL ? options->device : "";
+    char *key = g_strdup_printf("%s %s", address, characteristic->path);
+
+    LongWrite *longWrite = g_hash_table_lookup(application->long_writes, key);
+    if (longWrite != NULL && options->offset == 0) {
+        log_debug(TAG, "discarding unfinished long write to <%s> by %s", characteristic->uuid, address);
+        g_hash_table_remove(application->long_writes, key);
+        longWrite = NULL;
+    }
+
+    if (longWrite == NULL) {
+        // A write at an offset without an earlier fragment continues from the stored value
+        gsize current_size = characteristic->value != NULL ? g_bytes_get_size(characteristic->value) : 0;
+        if (options->offset > current_size) {
+            g_free(key);
+            binc_internal_write_reply(invocation, BLUEZ_ERROR_INVALID_OFFSET);
+            return;
+        }
+
+        longWrite = g_new0(LongWrite, 1);
+        longWrite->application = application;
+        longWrite->characteristic = characteristic;
+        longWrite->key = key;
+        longWrite->address = g_strdup(address);
+        longWrite->capacity = application->max_long_write_length;
+        longWrite->data = g_malloc(longWrite->capacity);
+        if (options->offset > 0) {
+            longWrite->length = (guint) MIN(current_size, longWrite->capacity);
+            memcpy(longWrite->data, g_bytes_get_data(characteristic->value, NULL), longWrite->length);
+        }
+        g_hash_table_insert(application->long_writes, longWrite->key, longWrite);
+    } else {
+        g_free(key);
+        if (options->offset > longWrite->length) {
+            g_hash_table_remove(application->long_writes, longWrite->key);
+            binc_internal_write_reply(invocation, BLUEZ_ERROR_INVALID_OFFSET);
+            return;
+        }
+    }
+
+    if (options->offset + size > longWrite->capacity) {
+        log_debug(TAG, "long write to <%s> by %s exceeds %u bytes", characteristic->uuid, address,
+                  longWrite->capacity);
+        g_hash_table_remove(application->long_writes, longWrite->key);
+        binc_internal_write_reply(invocation, BLUEZ_ERROR_INVALID_VALUE_LENGTH);
+        return;
+    }
+
+    memcpy(longWrite->data + options->offset, data, size);
+    longWrite->length = MAX(longWrite->length, (guint) (options->offset + size));
+    longWrite->mtu = options->mtu;
+
+    if (options->mtu > PREPARE_WRITE_HEADER_SIZE && size != (gsize) (options->mtu - PREPARE_WRITE_HEADER_SIZE)) {
+        binc_internal_long_write_finish(longWrite, invocation);
+        return;
+    }
+
+    if (longWrite->timeout_id != 0) {
+        g_source_remove(longWrite->timeout_id);
+    }
+    longWrite->timeout_id = g_timeout_add(LONG_WRITE_TIMEOUT_MS, binc_internal_long_write_timeout, longWrite);
+    binc_internal_write_reply(invocation, NULL);
+}
+
+static gboolean binc_internal_notify_socket_hangup(gint fd, GIOCondition condition, gpointer user_data) {
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) user_data;
+    Application *application = characteristic->application;
+
+    log_debug(TAG, "notify socket of <%s> closed by %s", characteristic->uuid, characteristic->notify_socket.address);
+
+    characteristic->notify_socket.watch_id = 0;
+    binc_acquired_socket_close(&characteristic->notify_socket);
+    binc_coalesce_state_clear(&characteristic->coalesce);
+    characteristic->notifying = FALSE;
+
+    if (application->on_char_stop_notify != NULL) {
+        application->on_char_stop_notify(characteristic->application, characteristic->service_uuid,
+                                         characteristic->uuid);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean binc_internal_notify_socket_writable(gint fd, GIOCondition condition, gpointer user_data) {
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) user_data;
+    AcquiredSocket *acquired = &characteristic->notify_socket;
+
+    while (!g_queue_is_empty(acquired->backlog)) {
+        gsize size = 0;
+        gconstpointer data = g_bytes_get_data(g_queue_peek_head(acquired->backlog), &size);
+        if (send(fd, data, size, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return G_SOURCE_CONTINUE;
+            }
+            log_debug(TAG, "failed to notify <%s>: %s", characteristic->uuid, g_strerror(errno));
+        }
+        g_bytes_unref(g_queue_pop_head(acquired->backlog));
+    }
+
+    // The socket has room again, so send the newest coalesced value on the next write-ready event
+    CoalesceState *coalesce = &characteristic->coalesce;
+    if (coalesce->pending != NULL) {
+        g_queue_push_tail(acquired->backlog, g_variant_get_data_as_bytes(coalesce->pending));
+        g_variant_unref(coalesce->pending);
+        coalesce->pending = NULL;
+        return G_SOURCE_CONTINUE;
+    }
+
+    acquired->out_watch_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Write a notification to an acquired notify socket. When the socket is full, the notification is kept
+ * until the socket is writable again so the order is preserved.
+ */
+static gboolean binc_internal_notify_socket_send(LocalCharacteristic *characteristic, const guint8 *data, gsize size) {
+    AcquiredSocket *acquired = &characteristic->notify_socket;
+
+    if (g_queue_is_empty(acquired->backlog)) {
+        if (send(acquired->fd, data, size, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) {
+            return TRUE;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_debug(TAG, "failed to notify <%s>: %s", characteristic->uuid, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    if (g_queue_get_length(acquired->backlog) >= NOTIFY_BACKLOG_LIMIT) {
+        log_debug(TAG, "dropping notification, backlog of <%s> is full", characteristic->uuid);
+        return FALSE;
+    }
+
+    g_queue_push_tail(acquired->backlog, g_bytes_new(data, size));
+    if (acquired->out_watch_id == 0) {
+        acquired->out_watch_id = g_unix_fd_add(acquired->fd, G_IO_OUT, binc_internal_notify_socket_writable,
+                                               characteristic);
+    }
+    return TRUE;
+}
+
+static gboolean binc_internal_write_socket_readable(gint fd, GIOCondition condition, gpointer user_data) {
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) user_data;
+    Application *application = characteristic->application;
+    AcquiredSocket *acquired = &characteristic->write_socket;
+
+    int count = 0;
+    if (condition & G_IO_IN) {
+        struct mmsghdr messages[WRITE_BATCH_SIZE];
+        struct iovec iovecs[WRITE_BATCH_SIZE];
+        memset(messages, 0, sizeof(messages));
+        for (guint i = 0; i < WRITE_BATCH_SIZE; i++) {
+            iovecs[i].iov_base = acquired->buffer + i * MAX_ATTRIBUTE_LENGTH;
+            iovecs[i].iov_len = MAX_ATTRIBUTE_LENGTH;
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        count = recvmmsg(fd, messages, WRITE_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_debug(TAG, "failed to read write socket of <%s>: %s", characteristic->uuid, g_strerror(errno));
+            condition |= G_IO_ERR;
+        }
+
+        for (int i = 0; i < count; i++) {
+            GBytes *bytes = g_bytes_new(iovecs[i].iov_base, messages[i].msg_len);
+            const char *result = binc_internal_characteristic_write(application, characteristic, acquired->address,
+                                                                    acquired->mtu, 0, bytes);
+            if (result != NULL) {
+                log_debug(TAG, "write rejected '%s'", result);
+            }
+        }
+    }
+
+    // Read the remaining packets first, the socket is closed after they are delivered
+    if (count == WRITE_BATCH_SIZE) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    if (condition & (G_IO_HUP | G_IO_ERR)) {
+        log_debug(TAG, "write socket of <%s> closed by %s", characteristic->uuid, acquired->address);
+        acquired->watch_id = 0;
+        binc_acquired_socket_close(acquired);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Create a socket pair, watch our end and hand the other end to Bluez
+ */
+static gboolean binc_internal_characteristic_acquire(LocalCharacteristic *characteristic, AcquiredSocket *acquired,
+                                                     GVariant *params, GDBusMethodInvocation *invocation,
+                                                     GIOCondition condition, GUnixFDSourceFunc callback) {
+    if (acquired->fd >= 0) {
+        g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_NOT_PERMITTED, "already acquired");
+        return FALSE;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+        log_debug(TAG, "could not create socket pair: %s", g_strerror(errno));
+        g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_FAILED, "could not create socket");
+        return FALSE;
+    }
+
+    GError *error = NULL;
+    GUnixFDList *fd_list = g_unix_fd_list_new();
+    gint index = g_unix_fd_list_append(fd_list, fds[1], &error);
+    close(fds[1]);
+    if (index < 0) {
+        log_debug(TAG, "could not pass socket: %s", error != NULL ? error->message : "unknown error");
+        g_clear_error(&error);
+        g_object_unref(fd_list);
+        close(fds[0]);
+        g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_FAILED, "could not pass socket");
+        return FALSE;
+    }
+
+    ReadOptions *options = parse_read_options(characteristic->application, params);
+    acquired->fd = fds[0];
+    acquired->mtu = options->mtu;
+    acquired->address = options->device;
+    options->device = NULL;
+    read_options_free(options);
+    acquired->watch_id = g_unix_fd_add(acquired->fd, condition, callback, characteristic);
+
+    g_dbus_method_invocation_return_value_with_unix_fd_list(invocation,
+                                                            g_variant_new("(hq)", index, acquired->mtu),
+                                                            fd_list);
+    g_object_unref(fd_list);
+    return TRUE;
+}
+
+/*
+ * Emit a PropertiesChanged signal for the 'ay' value, Bluez turns it into a notification or indication
+ */
+static gboolean binc_internal_emit_properties_changed(const Application *application,
+                                                      const LocalCharacteristic *characteristic,
+                                                      GVariant *value,
+                                                      GError **error) {
+    GVariant *entry = g_variant_new_dict_entry(g_variant_new_string("Value"), g_variant_new_variant(value));
+    GVariant *children[3] = {
+            application->char_interface_name,
+            g_variant_new_array(G_VARIANT_TYPE("{sv}"), &entry, 1),
+            application->no_invalidated_properties
+    };
+
+    return g_dbus_connection_emit_signal(application->connection,
+                                         NULL,
+                                         characteristic->path,
+                                         "org.freedesktop.DBus.Properties",
+                                         "PropertiesChanged",
+                                         g_variant_new_tuple(children, 3),
+                                         error);
+}
+
+/*
+ * Bluez sends a Confirm for every indication. Only characteristics that can't notify are tracked,
+ * otherwise the central may have enabled notifications and no Confirm would ever come.
+ */
+static gboolean binc_internal_uses_indications(const LocalCharacteristic *characteristic) {
+    return (characteristic->permissions & INDICATE_PROPERTIES) &&
+           !(characteristic->permissions & NOTIFY_PROPERTIES);
+}
+
+static void binc_internal_indication_done(LocalCharacteristic *characteristic, gboolean confirmed);
+
+static gboolean binc_internal_indication_timeout(gpointer user_data) {
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) user_data;
+    characteristic->indication.timeout_id = 0;
+
+    log_debug(TAG, "indication on <%s> not confirmed", characteristic->uuid);
+    binc_internal_indication_done(characteristic, FALSE);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean binc_internal_indication_send(LocalCharacteristic *characteristic, GVariant *value, GError **error) {
+    Application *application = characteristic->application;
+    IndicationState *indication = &characteristic->indication;
+
+    if (!binc_internal_emit_properties_changed(application, characteristic, value, error)) {
+        return FALSE;
+    }
+
+    indication->pending = TRUE;
+    indication->sent_us = g_get_monotonic_time();
+    indication->timeout_id = g_timeout_add(application->confirm_timeout_ms, binc_internal_indication_timeout,
+                                           characteristic);
+    application->indication_stats.sent++;
+    return TRUE;
+}
+
+/*
+ * The pending indication was confirmed or timed out, so send the next queued one
+ */
+static void binc_internal_indication_done(LocalCharacteristic *characteristic, gboolean confirmed) {
+    Application *application = characteristic->application;
+    IndicationState *indication = &characteristic->indication;
+    if (!indication->pending) return;
+
+    if (indication->timeout_id != 0) {
+        g_source_remove(indication->timeout_id);
+        indication->timeout_id = 0;
+    }
+    indication->pending = FALSE;
+
+    gint64 latency = g_get_monotonic_time() - indication->sent_us;
+    IndicationStats *stats = &application->indication_stats;
+    if (confirmed) {
+        stats->confirmed++;
+        stats->last_latency_us = latency;
+        stats->min_latency_us = stats->confirmed == 1 ? latency : MIN(stats->min_latency_us, latency);
+        stats->max_latency_us = MAX(stats->max_latency_us, latency);
+        stats->mean_latency_us += (latency - stats->mean_latency_us) / (gint64) stats->confirmed;
+    } else {
+        stats->timed_out++;
+    }
+
+    while (indication->queue != NULL && !g_queue_is_empty(indication->queue)) {
+        GVariant *value = g_queue_pop_head(indication->queue);
+        GError *error = NULL;
+        gboolean sent = binc_internal_indication_send(characteristic, value, &error);
+        g_variant_unref(value);
+        if (sent) break;
+
+        if (error != NULL) {
+            log_debug(TAG, "error emitting signal for <%s>: %s", characteristic->uuid, error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    // Called last so that indications sent from the callback are queued behind the ones already waiting
+    if (application->on_char_indication_complete != NULL) {
+        application->on_char_indication_complete(application, characteristic->service_uuid, characteristic->uuid,
+                                                 confirmed, latency);
+    }
+}
+
+static void binc_internal_characteristic_method_call(GDBusConnection *conn,
+                                                     const gchar *sender,
+                                                     const gchar *path,
+                                                     const gchar *interface,
+                                                     const gchar *method,
+                                                     GVariant *params,
+                                                     GDBusMethodInvocation *invocation,
+                                                     void *userdata) {
+
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) userdata;
+    g_assert(characteristic != NULL);
+
+    Application *application = characteristic->application;
+    g_assert(application != NULL);
+
+    if (g_str_equal(method, CHARACTERISTIC_METHOD_READ_VALUE)) {
+        log_debug(TAG, "read <%s>", characteristic->uuid);
+        ReadOptions *options = parse_read_options(application, params);
+
+        if (application->on_char_read_async != NULL) {
+            GattRequest *request = binc_internal_gatt_request_create(application, characteristic, invocation, FALSE,
+                                                                     options->offset, options->mtu);
+            application->on_char_read_async(characteristic->application, options->device,
+                                            characteristic->service_uuid, characteristic->uuid,
+                                            options->mtu, options->offset, request);
+            read_options_free(options);
+            return;
+        }
 
         // Allow application to accept/reject the characteristic value before setting it
         const char *result = NULL;
-        if (application->on_char_write != NULL) {
-            result = application->on_char_write(characteristic->application, options->device,
-                                                characteristic->service_uuid,
-                                                characteristic->uuid, byteArray, options->mtu, options->offset);
+        if (application->on_char_read != NULL) {
+            result = application->on_char_read(characteristic->application, options->device,
+                                               characteristic->service_uuid,
+                                               characteristic->uuid, options->mtu, options->offset);
         }
-        write_options_free(options);
 
         if (result) {
-            g_dbus_method_invocation_return_dbus_error(invocation, result, "write error");
-            log_debug(TAG, "write error");
+            read_options_free(options);
+            g_dbus_method_invocation_return_dbus_error(invocation, result, "read characteristic error");
+            log_debug(TAG, "read characteristic error '%s'", result);
             return;
         }
 
-        // TODO deal with offset and mtu
-        binc_characteristic_set_value(application, characteristic, byteArray);
+        binc_internal_characteristic_reply_value(invocation, characteristic, options->offset, options->mtu);
+        read_options_free(options);
+    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_WRITE_VALUE)) {
+        g_assert(g_str_equal(g_variant_get_type_string(params), "(aya{sv})"));
+        GVariant *valueVariant, *optionsVariant;
+
+        // Get the write options
+        g_variant_get(params, "(@ay@a{sv})", &valueVariant, &optionsVariant);
+        WriteOptions *options = parse_write_options(application, optionsVariant);
+        g_variant_unref(optionsVariant);
 
-        if (byteArray != NULL) {
+        log_debug(TAG, "write <%s>", characteristic->uuid);
+
+        // Prepared writes are only authorized here, the data is written again when they are executed
+        const char *result = NULL;
+        if (options->prepare_authorize) {
+            log_debug(TAG, "authorized prepared write");
+        } else if (binc_internal_is_long_write(options)) {
+            binc_internal_long_write_add(application, characteristic, options, valueVariant, invocation);
+            write_options_free(options);
+            g_variant_unref(valueVariant);
+            return;
+        } else if (application->on_char_write_async != NULL) {
+            GattRequest *request = binc_internal_gatt_request_create(application, characteristic, invocation, TRUE,
+                                                                     options->offset, options->mtu);
+            request->value = g_variant_get_data_as_bytes(valueVariant);
+            GByteArray *byteArray = g_variant_get_byte_array(valueVariant);
+            application->on_char_write_async(characteristic->application, options->device,
+                                             characteristic->service_uuid, characteristic->uuid, byteArray,
+                                             options->mtu, options->offset, request);
             g_byte_array_free(byteArray, FALSE);
+            write_options_free(options);
+            g_variant_unref(valueVariant);
+            return;
+        } else {
+            // Allow application to accept/reject the characteristic value before setting it
+            result = binc_internal_characteristic_write(application, characteristic, options->device,
+                                                        options->mtu, options->offset,
+                                                        g_variant_get_data_as_bytes(valueVariant));
         }
-
+        write_options_free(options);
         g_variant_unref(valueVariant);
 
-        g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
+        binc_internal_write_reply(invocation, result);
     } else if (g_str_equal(method, CHARACTERISTIC_METHOD_START_NOTIFY)) {
         log_debug(TAG, "start notify <%s>", characteristic->uuid);
 
@@ -1114,16 +2208,49 @@ static void binc_internal_characteristic_method_call(GDBusConnection *conn,
     } else if (g_str_equal(method, CHARACTERISTIC_METHOD_STOP_NOTIFY)) {
         log_debug(TAG, "stop notify <%s>", characteristic->uuid);
 
-        characteristic->notifying = FALSE;
-        g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
+        characteristic->notifying = FALSE;
+        binc_indication_state_clear(&characteristic->indication);
+        binc_coalesce_state_clear(&characteristic->coalesce);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
+
+        if (application->on_char_stop_notify != NULL) {
+            application->on_char_stop_notify(characteristic->application, characteristic->service_uuid,
+                                             characteristic->uuid);
+        }
+    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_CONFIRM)) {
+        log_debug(TAG, "indication confirmed <%s>", characteristic->uuid);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
+        binc_internal_indication_done(characteristic, TRUE);
+    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_ACQUIRE_NOTIFY)) {
+        log_debug(TAG, "acquire notify <%s>", characteristic->uuid);
+
+        if (!characteristic->acquire_notify) {
+            g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_NOT_SUPPORTED, "acquire not supported");
+            return;
+        }
+
+        if (binc_internal_characteristic_acquire(characteristic, &characteristic->notify_socket, params, invocation,
+                                                 G_IO_HUP | G_IO_ERR, binc_internal_notify_socket_hangup)) {
+            characteristic->notify_socket.backlog = g_queue_new();
+            characteristic->notifying = TRUE;
+
+            if (application->on_char_start_notify != NULL) {
+                application->on_char_start_notify(characteristic->application, characteristic->service_uuid,
+                                                  characteristic->uuid);
+            }
+        }
+    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_ACQUIRE_WRITE)) {
+        log_debug(TAG, "acquire write <%s>", characteristic->uuid);
+
+        if (!characteristic->acquire_write) {
+            g_dbus_method_invocation_return_dbus_error(invocation, BLUEZ_ERROR_NOT_SUPPORTED, "acquire not supported");
+            return;
+        }
 
-        if (application->on_char_stop_notify != NULL) {
-            application->on_char_stop_notify(characteristic->application, characteristic->service_uuid,
-                                             characteristic->uuid);
+        if (binc_internal_characteristic_acquire(characteristic, &characteristic->write_socket, params, invocation,
+                                                 G_IO_IN | G_IO_HUP | G_IO_ERR, binc_internal_write_socket_readable)) {
+            characteristic->write_socket.buffer = g_malloc(WRITE_BATCH_SIZE * MAX_ATTRIBUTE_LENGTH);
         }
-    } else if (g_str_equal(method, CHARACTERISTIC_METHOD_CONFIRM)) {
-        log_debug(TAG, "indication confirmed <%s>", characteristic->uuid);
-        g_dbus_method_invocation_return_value(invocation, g_variant_new("()"));
     }
 }
 
@@ -1148,9 +2275,16 @@ GVariant *characteristic_get_property(GDBusConnection *connection,
         ret = binc_local_characteristic_get_flags(characteristic);
     } else if (g_str_equal(property_name, "Notifying")) {
         ret = g_variant_new_boolean(characteristic->notifying);
+    } else if (g_str_equal(property_name, "WriteAcquired")) {
+        ret = g_variant_new_boolean(characteristic->write_socket.fd >= 0);
+    } else if (g_str_equal(property_name, "NotifyAcquired")) {
+        ret = g_variant_new_boolean(characteristic->notify_socket.fd >= 0);
     } else if (g_str_equal(property_name, "Value")) {
-        ret = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, characteristic->value->data, characteristic->value->len,
-                                        sizeof(guint8));
+        if (characteristic->value != NULL) {
+            ret = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, characteristic->value, TRUE);
+        } else {
+            ret = g_variant_new_array(G_VARIANT_TYPE_BYTE, NULL, 0);
+        }
     }
     return ret;
 }
@@ -1160,35 +2294,23 @@ static const GDBusInterfaceVTable characteristic_table = {
         .get_property = characteristic_get_property
 };
 
-int binc_application_add_characteristic(Application *application, const char *service_uuid,
-                                        const char *char_uuid, guint permissions) {
-
-    g_return_val_if_fail (application != NULL, EINVAL);
-    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
-    g_return_val_if_fail (is_valid_uuid(char_uuid), EINVAL);
-
-    LocalService *localService = binc_application_get_service(application, service_uuid);
-    if (localService == NULL) {
-        g_critical("service %s does not exist", service_uuid);
-        return EINVAL;
-    }
-
-    GError *error = NULL;
-    GDBusNodeInfo *info = NULL;
-    info = g_dbus_node_info_new_for_xml(characteristic_xml, &error);
-    if (error) {
-        log_debug(TAG, "Unable to create node: %s\n", error->message);
-        g_clear_error(&error);
-        return EINVAL;
-    }
+static LocalCharacteristic *binc_internal_application_add_characteristic(Application *application,
+                                                                         LocalService *localService,
+                                                                         const char *char_uuid, guint permissions) {
+    GDBusInterfaceInfo *interface_info = binc_internal_get_interface_info(&characteristic_node_info,
+                                                                         characteristic_xml);
+    if (interface_info == NULL) return NULL;
 
     LocalCharacteristic *characteristic = g_new0(LocalCharacteristic, 1);
-    characteristic->service_uuid = g_strdup(service_uuid);
+    characteristic->service_uuid = g_strdup(localService->uuid);
     characteristic->service_path = g_strdup(localService->path);
     characteristic->uuid = g_strdup(char_uuid);
     characteristic->permissions = permissions;
     characteristic->flags = permissions2Flags(permissions);
     characteristic->value = NULL;
+    characteristic->notify_socket.fd = -1;
+    characteristic->write_socket.fd = -1;
+    characteristic->handle = -1;
     characteristic->application = application;
     characteristic->path = g_strdup_printf("%s/char%d",
                                            localService->path,
@@ -1199,27 +2321,148 @@ int binc_application_add_characteristic(Application *application, const char *se
             g_free,
             (GDestroyNotify) binc_local_desc_free);
     g_hash_table_insert(localService->characteristics, g_strdup(char_uuid), characteristic);
+    binc_internal_application_invalidate_managed_objects(application);
 
     // Register characteristic
+    GError *error = NULL;
     characteristic->registration_id = g_dbus_connection_register_object(application->connection,
                                                                         characteristic->path,
-                                                                        info->interfaces[0],
+                                                                        interface_info,
                                                                         &characteristic_table,
                                                                         characteristic,
                                                                         NULL,
                                                                         &error);
-    g_dbus_node_info_unref(info);
 
     if (characteristic->registration_id == 0) {
         log_debug(TAG, "failed to publish local characteristic");
         log_debug(TAG, "Error %s", error->message);
         g_clear_error(&error);
         g_hash_table_remove(localService->characteristics, char_uuid);
-        return EINVAL;
+        return NULL;
     }
 
+    characteristic->handle = (int) application->char_handles->len;
+    g_ptr_array_add(application->char_handles, characteristic);
+
     log_debug(TAG, "successfully published local characteristic %s", char_uuid);
-    return 0;
+    return characteristic;
+}
+
+int binc_application_add_characteristic(Application *application, const char *service_uuid,
+                                        const char *char_uuid, guint permissions) {
+
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), -EINVAL);
+    g_return_val_if_fail (is_valid_uuid(char_uuid), -EINVAL);
+
+    LocalService *localService = binc_application_get_service(application, service_uuid);
+    if (localService == NULL) {
+        g_critical("service %s does not exist", service_uuid);
+        return -EINVAL;
+    }
+
+    LocalCharacteristic *characteristic = binc_internal_application_add_characteristic(application, localService,
+                                                                                       char_uuid, permissions);
+    return characteristic != NULL ? characteristic->handle : -EINVAL;
+}
+
+int binc_application_add_gatt_table(Application *application, const GattAttribute *table, guint count,
+                                    int *handles, GattTableStats *stats) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (table != NULL, -EINVAL);
+
+    gint64 start = g_get_monotonic_time();
+    GattTableStats result = {0};
+    LocalService *service = NULL;
+    LocalCharacteristic *characteristic = NULL;
+    int status = 0;
+
+    if (handles != NULL) {
+        for (guint i = 0; i < count; i++) {
+            handles[i] = -1;
+        }
+    }
+
+    for (guint i = 0; i < count && status == 0; i++) {
+        const GattAttribute *attribute = &table[i];
+        int handle = -1;
+
+        if (!is_valid_uuid(attribute->uuid)) {
+            g_critical("%s: entry %u has an invalid uuid", G_STRFUNC, i);
+            status = -EINVAL;
+            break;
+        }
+
+        switch (attribute->type) {
+            case BINC_GATT_SERVICE:
+                service = binc_internal_application_add_service(application, attribute->uuid);
+                characteristic = NULL;
+                if (service == NULL) {
+                    status = -EINVAL;
+                } else {
+                    result.services++;
+                }
+                break;
+            case BINC_GATT_CHARACTERISTIC:
+                characteristic = NULL;
+                if (service == NULL) {
+                    g_critical("%s: characteristic %s is not preceded by a service", G_STRFUNC, attribute->uuid);
+                    status = -EINVAL;
+                    break;
+                }
+                characteristic = binc_internal_application_add_characteristic(application, service, attribute->uuid,
+                                                                              attribute->permissions);
+                if (characteristic == NULL) {
+                    status = -EINVAL;
+                    break;
+                }
+                if (attribute->value != NULL) {
+                    binc_characteristic_set_value(application, characteristic,
+                                                  g_bytes_new(attribute->value, attribute->value_length));
+                }
+                handle = characteristic->handle;
+                result.characteristics++;
+                break;
+            case BINC_GATT_DESCRIPTOR: {
+                if (characteristic == NULL) {
+                    g_critical("%s: descriptor %s is not preceded by a characteristic", G_STRFUNC, attribute->uuid);
+                    status = -EINVAL;
+                    break;
+                }
+                LocalDescriptor *descriptor = binc_internal_application_add_descriptor(application, characteristic,
+                                                                                       attribute->uuid,
+                                                                                       attribute->permissions);
+                if (descriptor == NULL) {
+                    status = -EINVAL;
+                    break;
+                }
+                if (attribute->value != NULL) {
+                    binc_descriptor_set_value(application, descriptor,
+                                              g_bytes_new(attribute->value, attribute->value_length));
+                }
+                handle = descriptor->handle;
+                result.descriptors++;
+                break;
+            }
+            default:
+                g_critical("%s: entry %u has an unknown type", G_STRFUNC, i);
+                status = -EINVAL;
+                break;
+        }
+
+        if (handles != NULL && status == 0) {
+            handles[i] = handle;
+        }
+    }
+
+    result.duration_us = g_get_monotonic_time() - start;
+    log_debug(TAG, "registered %u services, %u characteristics and %u descriptors in %ld us",
+              result.services, result.characteristics, result.descriptors, (long) result.duration_us);
+
+    if (stats != NULL) {
+        *stats = result;
+    }
+    return status;
 }
 
 const char *binc_application_get_path(const Application *application) {
@@ -1234,6 +2477,42 @@ void binc_application_set_char_read_cb(Application *application, onLocalCharacte
     application->on_char_read = callback;
 }
 
+void binc_application_set_char_read_async_cb(Application *application, onLocalCharacteristicReadAsync callback) {
+    g_assert(application != NULL);
+    g_assert(callback != NULL);
+
+    application->on_char_read_async = callback;
+}
+
+void binc_application_set_char_write_async_cb(Application *application, onLocalCharacteristicWriteAsync callback) {
+    g_assert(application != NULL);
+    g_assert(callback != NULL);
+
+    application->on_char_write_async = callback;
+}
+
+void binc_application_set_request_timeout(Application *application, guint timeout_ms) {
+    g_assert(application != NULL);
+    g_assert(timeout_ms > 0);
+
+    application->request_timeout_ms = timeout_ms;
+}
+
+void binc_application_set_char_indication_complete_cb(Application *application,
+                                                     onLocalCharacteristicIndicationComplete callback) {
+    g_assert(application != NULL);
+    g_assert(callback != NULL);
+
+    application->on_char_indication_complete = callback;
+}
+
+void binc_application_set_confirm_timeout(Application *application, guint timeout_ms) {
+    g_assert(application != NULL);
+    g_assert(timeout_ms > 0);
+
+    application->confirm_timeout_ms = timeout_ms;
+}
+
 void binc_application_set_char_updated_cb(Application *application, onLocalCharacteristicUpdated callback) {
     g_assert(application != NULL);
     g_assert(callback != NULL);
@@ -1241,6 +2520,46 @@ void binc_application_set_char_updated_cb(Application *application, onLocalChara
     application->on_char_updated = callback;
 }
 
+static int binc_internal_application_set_char_acquire(Application *application, const char *service_uuid,
+                                                      const char *char_uuid, gboolean notify, gboolean enabled) {
+    g_return_val_if_fail (application != NULL, EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
+    g_return_val_if_fail (is_valid_uuid(char_uuid), EINVAL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    if (characteristic == NULL) {
+        g_critical("%s: characteristic with uuid %s does not exist", G_STRFUNC, char_uuid);
+        return EINVAL;
+    }
+
+    if (notify) {
+        characteristic->acquire_notify = enabled;
+        if (!enabled) binc_acquired_socket_close(&characteristic->notify_socket);
+    } else {
+        characteristic->acquire_write = enabled;
+        if (!enabled) binc_acquired_socket_close(&characteristic->write_socket);
+    }
+    binc_internal_application_invalidate_managed_objects(application);
+    return 0;
+}
+
+int binc_application_set_char_acquire_notify(Application *application, const char *service_uuid,
+                                             const char *char_uuid, gboolean enabled) {
+    return binc_internal_application_set_char_acquire(application, service_uuid, char_uuid, TRUE, enabled);
+}
+
+int binc_application_set_char_acquire_write(Application *application, const char *service_uuid,
+                                            const char *char_uuid, gboolean enabled) {
+    return binc_internal_application_set_char_acquire(application, service_uuid, char_uuid, FALSE, enabled);
+}
+
+void binc_application_set_max_long_write_length(Application *application, guint max_length) {
+    g_assert(application != NULL);
+    g_assert(max_length > 0);
+
+    application->max_long_write_length = max_length;
+}
+
 void binc_application_set_char_write_cb(Application *application, onLocalCharacteristicWrite callback) {
     g_assert(application != NULL);
     g_assert(callback != NULL);
@@ -1276,6 +2595,130 @@ void binc_application_set_char_stop_notify_cb(Application *application, onLocalC
     application->on_char_stop_notify = callback;
 }
 
+/*
+ * Emit a PropertiesChanged signal for the value, which is a floating 'ay' GVariant.
+ * If a central acquired the notify socket, the value is written to the socket instead.
+ * Indications are queued while the previous one is not confirmed yet.
+ */
+static gboolean binc_internal_application_emit_value_now(const Application *application,
+                                                         LocalCharacteristic *characteristic,
+                                                         GVariant *value,
+                                                         GError **error) {
+    if (characteristic->notify_socket.fd >= 0) {
+        g_variant_ref_sink(value);
+        gsize size = 0;
+        const guint8 *data = g_variant_get_fixed_array(value, &size, sizeof(guint8));
+        gboolean result = binc_internal_notify_socket_send(characteristic, data, size);
+        g_variant_unref(value);
+        return result;
+    }
+
+    if (binc_internal_uses_indications(characteristic)) {
+        IndicationState *indication = &characteristic->indication;
+        if (!indication->pending) {
+            return binc_internal_indication_send(characteristic, value, error);
+        }
+
+        if (indication->queue == NULL) {
+            indication->queue = g_queue_new();
+        }
+
+        g_variant_ref_sink(value);
+        if (g_queue_get_length(indication->queue) >= INDICATION_QUEUE_LIMIT) {
+            log_debug(TAG, "dropping indication, queue of <%s> is full", characteristic->uuid);
+            characteristic->application->indication_stats.dropped++;
+            g_variant_unref(value);
+            return FALSE;
+        }
+        g_queue_push_tail(indication->queue, value);
+        return TRUE;
+    }
+
+    return binc_internal_emit_properties_changed(application, characteristic, value, error);
+}
+
+static gboolean binc_internal_coalesce_timer(gpointer user_data) {
+    LocalCharacteristic *characteristic = (LocalCharacteristic *) user_data;
+    CoalesceState *coalesce = &characteristic->coalesce;
+
+    // Nothing changed during the last interval, so the next update can go out immediately
+    if (coalesce->pending == NULL) {
+        coalesce->timer_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    GVariant *value = coalesce->pending;
+    coalesce->pending = NULL;
+
+    GError *error = NULL;
+    if (!binc_internal_application_emit_value_now(characteristic->application, characteristic, value, &error) &&
+        error != NULL) {
+        log_debug(TAG, "error emitting signal for <%s>: %s", characteristic->uuid, error->message);
+        g_clear_error(&error);
+    }
+    g_variant_unref(value);
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Send at most one value per interval, or per write-ready event of an acquired notify socket.
+ * An update that arrives while the previous one can't be sent yet replaces it.
+ */
+static gboolean binc_internal_coalesce_value(LocalCharacteristic *characteristic, GVariant *value, GError **error) {
+    CoalesceState *coalesce = &characteristic->coalesce;
+
+    gboolean busy = characteristic->notify_socket.fd >= 0 ? characteristic->notify_socket.out_watch_id != 0
+                                                          : coalesce->timer_id != 0;
+    if (!busy) {
+        if (characteristic->notify_socket.fd < 0) {
+            coalesce->timer_id = g_timeout_add(coalesce->interval_ms, binc_internal_coalesce_timer, characteristic);
+        }
+        return binc_internal_application_emit_value_now(characteristic->application, characteristic, value, error);
+    }
+
+    if (coalesce->pending != NULL) {
+        g_variant_unref(coalesce->pending);
+        characteristic->application->notify_stats.superseded++;
+    }
+    coalesce->pending = g_variant_ref_sink(value);
+    return TRUE;
+}
+
+static gboolean binc_internal_application_emit_value(const Application *application,
+                                                     LocalCharacteristic *characteristic,
+                                                     GVariant *value,
+                                                     GError **error) {
+    if (characteristic->coalesce.interval_ms > 0) {
+        return binc_internal_coalesce_value(characteristic, value, error);
+    }
+    return binc_internal_application_emit_value_now(application, characteristic, value, error);
+}
+
+static int binc_internal_application_notify(const Application *application, LocalCharacteristic *characteristic,
+                                            const GByteArray *byteArray) {
+    // Nobody would receive it, so don't bother encoding and sending it
+    if (!characteristic->notifying) {
+        return 0;
+    }
+
+    GVariant *value = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byteArray->data, byteArray->len, sizeof(guint8));
+    GError *error = NULL;
+    if (!binc_internal_application_emit_value(application, characteristic, value, &error)) {
+        if (error != NULL) {
+            log_debug(TAG, "error emitting signal: %s", error->message);
+            g_clear_error(&error);
+        }
+        return EINVAL;
+    }
+
+    if (log_get_level() <= LOG_DEBUG) {
+        GString *byteArrayStr = g_byte_array_as_hex(byteArray);
+        log_debug(TAG, "notified <%s> on <%s>", byteArrayStr->str, characteristic->uuid);
+        g_string_free(byteArrayStr, TRUE);
+    }
+    return 0;
+}
+
 int binc_application_notify(const Application *application, const char *service_uuid, const char *char_uuid,
                             const GByteArray *byteArray) {
 
@@ -1290,29 +2733,34 @@ int binc_application_notify(const Application *application, const char *service_
         return EINVAL;
     }
 
-    GVariant *valueVariant = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
-                                                       byteArray->data,
-                                                       byteArray->len,
-                                                       sizeof(guint8));
-    GVariantBuilder *properties_builder = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
-    g_variant_builder_add(properties_builder, "{sv}", "Value", valueVariant);
-    GVariantBuilder *invalidated_builder = g_variant_builder_new(G_VARIANT_TYPE("as"));
+    return binc_internal_application_notify(application, characteristic, byteArray);
+}
+
+int binc_application_notify_by_handle(const Application *application, int handle, const GByteArray *byteArray) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (byteArray != NULL, -EINVAL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        return -EINVAL;
+    }
+
+    return -binc_internal_application_notify(application, characteristic, byteArray);
+}
+
+static int binc_internal_application_notify_bytes(const Application *application, LocalCharacteristic *characteristic,
+                                                  GBytes *bytes) {
+    // The value, ReadValue replies and the signal all share the same buffer
+    binc_characteristic_set_value(application, characteristic, bytes);
+    if (!characteristic->notifying) {
+        return 0;
+    }
+
+    GVariant *value = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, characteristic->value, TRUE);
 
     GError *error = NULL;
-    gboolean result = g_dbus_connection_emit_signal(application->connection,
-                                                    NULL,
-                                                    characteristic->path,
-                                                    "org.freedesktop.DBus.Properties",
-                                                    "PropertiesChanged",
-                                                    g_variant_new("(sa{sv}as)",
-                                                                  "org.bluez.GattCharacteristic1",
-                                                                  properties_builder, invalidated_builder),
-                                                    &error);
-
-    g_variant_builder_unref(invalidated_builder);
-    g_variant_builder_unref(properties_builder);
-
-    if (result != TRUE) {
+    if (!binc_internal_application_emit_value(application, characteristic, value, &error)) {
         if (error != NULL) {
             log_debug(TAG, "error emitting signal: %s", error->message);
             g_clear_error(&error);
@@ -1320,12 +2768,186 @@ int binc_application_notify(const Application *application, const char *service_
         return EINVAL;
     }
 
-    GString *byteArrayStr = g_byte_array_as_hex(byteArray);
-    log_debug(TAG, "notified <%s> on <%s>", byteArrayStr->str, characteristic->uuid);
-    g_string_free(byteArrayStr, TRUE);
+    log_debug(TAG, "notified <%s>", characteristic->uuid);
+    return 0;
+}
+
+int binc_application_notify_bytes(const Application *application, const char *service_uuid, const char *char_uuid,
+                                  GBytes *bytes) {
+
+    g_return_val_if_fail (bytes != NULL, EINVAL);
+
+    LocalCharacteristic *characteristic = NULL;
+    if (application != NULL && is_valid_uuid(service_uuid) && is_valid_uuid(char_uuid)) {
+        characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    }
+
+    if (characteristic == NULL) {
+        g_critical("%s: characteristic %s does not exist", G_STRFUNC, char_uuid);
+        g_bytes_unref(bytes);
+        return EINVAL;
+    }
+
+    return binc_internal_application_notify_bytes(application, characteristic, bytes);
+}
+
+int binc_application_notify_bytes_by_handle(const Application *application, int handle, GBytes *bytes) {
+    g_return_val_if_fail (bytes != NULL, -EINVAL);
+
+    LocalCharacteristic *characteristic = NULL;
+    if (application != NULL) {
+        characteristic = get_local_characteristic_by_handle(application, handle);
+    }
+
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        g_bytes_unref(bytes);
+        return -EINVAL;
+    }
+
+    return -binc_internal_application_notify_bytes(application, characteristic, bytes);
+}
+
+static int binc_internal_application_queue_notify(Application *application, LocalCharacteristic *characteristic,
+                                                  const GByteArray *byteArray) {
+    if (!characteristic->notifying) {
+        application->notify_stats.skipped++;
+        return 0;
+    }
+
+    QueuedNotification *notification = g_new0(QueuedNotification, 1);
+    notification->characteristic = characteristic;
+    notification->value = g_bytes_new(byteArray->data, byteArray->len);
+    g_ptr_array_add(application->queued_notifications, notification);
+    return 0;
+}
+
+int binc_application_queue_notify(Application *application, const char *service_uuid, const char *char_uuid,
+                                  const GByteArray *byteArray) {
+
+    g_return_val_if_fail (application != NULL, EINVAL);
+    g_return_val_if_fail (byteArray != NULL, EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
+    g_return_val_if_fail (is_valid_uuid(char_uuid), EINVAL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    if (characteristic == NULL) {
+        g_critical("%s: characteristic %s does not exist", G_STRFUNC, char_uuid);
+        return EINVAL;
+    }
+
+    return binc_internal_application_queue_notify(application, characteristic, byteArray);
+}
+
+int binc_application_queue_notify_by_handle(Application *application, int handle, const GByteArray *byteArray) {
+    g_return_val_if_fail (application != NULL, -EINVAL);
+    g_return_val_if_fail (byteArray != NULL, -EINVAL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        return -EINVAL;
+    }
+
+    return -binc_internal_application_queue_notify(application, characteristic, byteArray);
+}
+
+guint binc_application_flush_notifications(Application *application) {
+    g_assert(application != NULL);
+
+    guint count = application->queued_notifications->len;
+    if (count == 0) return 0;
+
+    gint64 start = g_get_monotonic_time();
+    guint emitted = 0;
+    guint skipped = 0;
+    for (guint i = 0; i < count; i++) {
+        QueuedNotification *notification = g_ptr_array_index(application->queued_notifications, i);
+
+        // The central may have unsubscribed since the notification was queued
+        if (!notification->characteristic->notifying) {
+            skipped++;
+            continue;
+        }
+
+        GError *error = NULL;
+        GVariant *value = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, notification->value, TRUE);
+        if (binc_internal_application_emit_value(application, notification->characteristic, value, &error)) {
+            emitted++;
+        } else if (error != NULL) {
+            log_debug(TAG, "error emitting signal for <%s>: %s", notification->characteristic->uuid,
+                      error->message);
+            g_clear_error(&error);
+        }
+    }
+    g_ptr_array_set_size(application->queued_notifications, 0);
+    gint64 duration = g_get_monotonic_time() - start;
+
+    NotifyStats *stats = &application->notify_stats;
+    stats->flushes++;
+    stats->emitted += emitted;
+    stats->skipped += skipped;
+    stats->failed += count - emitted - skipped;
+    stats->last_batch_size = count;
+    stats->last_flush_us = duration;
+    stats->max_flush_us = MAX(stats->max_flush_us, duration);
+    stats->mean_flush_us += (duration - stats->mean_flush_us) / (gint64) stats->flushes;
+
+    log_debug(TAG, "flushed %u notifications in %ld us", emitted, (long) duration);
+    return emitted;
+}
+
+guint16 binc_application_get_central_mtu(const Application *application, const char *address) {
+    g_return_val_if_fail (application != NULL, 0);
+    g_return_val_if_fail (address != NULL, 0);
+
+    return (guint16) GPOINTER_TO_UINT(g_hash_table_lookup(application->central_mtus, address));
+}
+
+guint binc_application_get_queued_notify_count(const Application *application) {
+    g_assert(application != NULL);
+    return application->queued_notifications->len;
+}
+
+void binc_application_get_notify_stats(const Application *application, NotifyStats *stats) {
+    g_assert(application != NULL);
+    g_assert(stats != NULL);
+
+    *stats = application->notify_stats;
+}
+
+int binc_application_set_char_coalescing(const Application *application, const char *service_uuid,
+                                         const char *char_uuid, guint interval_ms) {
+    g_return_val_if_fail (application != NULL, EINVAL);
+    g_return_val_if_fail (is_valid_uuid(service_uuid), EINVAL);
+    g_return_val_if_fail (is_valid_uuid(char_uuid), EINVAL);
+
+    LocalCharacteristic *characteristic = get_local_characteristic(application, service_uuid, char_uuid);
+    if (characteristic == NULL) {
+        g_critical("%s: characteristic %s does not exist", G_STRFUNC, char_uuid);
+        return EINVAL;
+    }
+
+    // Send what is pending now so that switching modes never loses the newest value
+    CoalesceState *coalesce = &characteristic->coalesce;
+    if (coalesce->pending != NULL) {
+        GVariant *value = coalesce->pending;
+        coalesce->pending = NULL;
+        binc_internal_application_emit_value_now(application, characteristic, value, NULL);
+        g_variant_unref(value);
+    }
+    binc_coalesce_state_clear(coalesce);
+    coalesce->interval_ms = interval_ms;
     return 0;
 }
 
+void binc_application_get_indication_stats(const Application *application, IndicationStats *stats) {
+    g_assert(application != NULL);
+    g_assert(stats != NULL);
+
+    *stats = application->indication_stats;
+}
+
 gboolean binc_application_char_is_notifying(const Application *application, const char *service_uuid,
                                             const char *char_uuid) {
     g_return_val_if_fail (application != NULL, FALSE);
@@ -1341,6 +2963,18 @@ gboolean binc_application_char_is_notifying(const Application *application, cons
     return characteristic->notifying;
 }
 
+gboolean binc_application_char_is_notifying_by_handle(const Application *application, int handle) {
+    g_return_val_if_fail (application != NULL, FALSE);
+
+    LocalCharacteristic *characteristic = get_local_characteristic_by_handle(application, handle);
+    if (characteristic == NULL) {
+        g_critical("%s: invalid characteristic handle %d", G_STRFUNC, handle);
+        return FALSE;
+    }
+
+    return characteristic->notifying;
+}
+
 void binc_application_set_user_data(Application *application, void *user_data){
     g_assert(application != NULL);
     application->user_data = user_data;
@@ -31,6 +31,69 @@
 extern "C" {
 #endif
 
+/**
+ * Statistics of batched notifications, see binc_application_flush_notifications
+ */
+typedef struct binc_notify_stats {
+    guint64 flushes;
+    guint64 emitted;
+    guint64 failed;
+    guint64 skipped; // Not sent because no central was subscribed
+    guint64 superseded; // Replaced by a newer value before it was sent, see binc_application_set_char_coalescing
+    guint last_batch_size;
+    gint64 last_flush_us;
+    gint64 max_flush_us;
+    gint64 mean_flush_us;
+} NotifyStats;
+
+/**
+ * Statistics of indications, see binc_application_set_char_indication_complete_cb
+ */
+typedef struct binc_indication_stats {
+    guint64 sent;
+    guint64 confirmed;
+    guint64 timed_out;
+    guint64 dropped; // Not sent because the queue was full
+    gint64 last_latency_us;
+    gint64 min_latency_us;
+    gint64 max_latency_us;
+    gint64 mean_latency_us;
+} IndicationStats;
+
+typedef enum GattAttributeType {
+    BINC_GATT_SERVICE = 0, BINC_GATT_CHARACTERISTIC = 1, BINC_GATT_DESCRIPTOR = 2
+} GattAttributeType;
+
+/**
+ * An entry of a GATT table for binc_application_add_gatt_table.
+ * A service is followed by its characteristics, and a characteristic by its descriptors.
+ */
+typedef struct binc_gatt_attribute {
+    GattAttributeType type;
+    const char *uuid;
+    guint permissions;
+    const guint8 *value; // Initial value, copied, may be NULL
+    guint value_length;
+} GattAttribute;
+
+#define GATT_SERVICE(uuid) { BINC_GATT_SERVICE, (uuid), 0, NULL, 0 }
+#define GATT_CHARACTERISTIC(uuid, permissions) { BINC_GATT_CHARACTERISTIC, (uuid), (permissions), NULL, 0 }
+#define GATT_CHARACTERISTIC_VALUE(uuid, permissions, value) \
+    { BINC_GATT_CHARACTERISTIC, (uuid), (permissions), (value), sizeof(value) }
+#define GATT_DESCRIPTOR(uuid, permissions) { BINC_GATT_DESCRIPTOR, (uuid), (permissions), NULL, 0 }
+#define GATT_DESCRIPTOR_VALUE(uuid, permissions, value) \
+    { BINC_GATT_DESCRIPTOR, (uuid), (permissions), (value), sizeof(value) }
+
+/**
+ * Result of binc_application_add_gatt_table
+ */
+typedef struct binc_gatt_table_stats {
+    guint services;
+    guint characteristics;
+    guint descriptors;
+    gint64 duration_us;
+} GattTableStats;
+
 // Errors
 #define BLUEZ_ERROR_REJECTED "org.bluez.Error.Rejected"
 #define BLUEZ_ERROR_FAILED "org.bluez.Error.Failed"
@@ -39,6 +102,7 @@ extern "C" {
 #define BLUEZ_ERROR_INVALID_VALUE_LENGTH "org.bluez.Error.InvalidValueLength"
 #define BLUEZ_ERROR_NOT_AUTHORIZED "org.bluez.Error.NotAuthorized"
 #define BLUEZ_ERROR_NOT_SUPPORTED "org.bluez.Error.NotSupported"
+#define BLUEZ_ERROR_INVALID_OFFSET "org.bluez.Error.InvalidOffset"
 
 // This callback is called just before the characteristic's value is returned.
 // Use it to update the characteristic before it is read
@@ -47,6 +111,23 @@ typedef const char *(*onLocalCharacteristicRead)(const Application *application,
                                                  const char *service_uuid, const char *char_uuid, const guint16 mtu,
                                                  const guint16 offset);
 
+/**
+ * A read or write request that is answered later with binc_gatt_request_accept or binc_gatt_request_reject
+ */
+typedef struct binc_gatt_request GattRequest;
+
+// Like onLocalCharacteristicRead, but the read is answered later by completing the request
+typedef void (*onLocalCharacteristicReadAsync)(const Application *application, const char *address,
+                                               const char *service_uuid, const char *char_uuid, const guint16 mtu,
+                                               const guint16 offset, GattRequest *request);
+
+// Like onLocalCharacteristicWrite, but the write is answered later by completing the request.
+// The byte array is only valid during the callback.
+typedef void (*onLocalCharacteristicWriteAsync)(const Application *application, const char *address,
+                                                const char *service_uuid, const char *char_uuid,
+                                                GByteArray *byteArray, const guint16 mtu, const guint16 offset,
+                                                GattRequest *request);
+
 // This callback is called just before the characteristic's value is set.
 // Use it to accept (return NULL), or reject (return BLUEZ_ERROR_*) the byte array
 typedef const char *(*onLocalCharacteristicWrite)(const Application *application, const char *address,
@@ -66,6 +147,11 @@ typedef void (*onLocalCharacteristicStartNotify)(const Application *application,
 typedef void (*onLocalCharacteristicStopNotify)(const Application *application, const char *service_uuid,
                                                 const char *char_uuid);
 
+// This callback is called when an indication was confirmed by the central or timed out
+typedef void (*onLocalCharacteristicIndicationComplete)(const Application *application, const char *service_uuid,
+                                                        const char *char_uuid, gboolean confirmed,
+                                                        gint64 latency_us);
+
 // This callback is called just before the descriptor's value is returned.
 // Use it to update the descriptor before it is read
 typedef const char *(*onLocalDescriptorRead)(const Application *application, const char *address,
@@ -84,30 +170,155 @@ void binc_application_free(Application *application);
 
 const char *binc_application_get_path(const Application *application);
 
+/**
+ * Add a service
+ *
+ * @return 0 if successful, -EINVAL if the service could not be added
+ */
 int binc_application_add_service(Application *application, const char *service_uuid);
 
+/**
+ * Add a characteristic to a service
+ *
+ * @return a handle (>= 0) for the *_by_handle functions, or -EINVAL if the characteristic could not be added
+ */
 int binc_application_add_characteristic(Application *application, const char *service_uuid,
                                         const char *char_uuid, guint permissions);
 
+/**
+ * Add a descriptor to a characteristic
+ *
+ * @return a handle (>= 0) for the *_by_handle functions, or -EINVAL if the descriptor could not be added
+ */
 int binc_application_add_descriptor(Application *application, const char *service_uuid,
                                     const char *char_uuid, const char *desc_uuid, guint permissions);
 
+/**
+ * Add a complete GATT database in one pass
+ *
+ * @param table the services, characteristics and descriptors to add, in order
+ * @param count the number of entries in table
+ * @param handles if not NULL, receives the handle of each characteristic and descriptor at the index of its
+ * entry, and -1 for services and entries that were not added
+ * @param stats if not NULL, receives the number of attributes added and the time it took
+ * @return 0 if successful, -EINVAL if an entry is invalid. Entries before the invalid one stay registered.
+ */
+int binc_application_add_gatt_table(Application *application, const GattAttribute *table, guint count,
+                                    int *handles, GattTableStats *stats);
+
 void binc_application_set_char_read_cb(Application *application, onLocalCharacteristicRead callback);
 
 void binc_application_set_char_write_cb(Application *application, onLocalCharacteristicWrite callback);
 
+/**
+ * Handle reads asynchronously. When set, it is used instead of the callback set with binc_application_set_char_read_cb.
+ */
+void binc_application_set_char_read_async_cb(Application *application, onLocalCharacteristicReadAsync callback);
+
+/**
+ * Handle writes asynchronously. When set, it is used instead of the callback set with
+ * binc_application_set_char_write_cb, except for writes on an acquired socket. Long writes are passed once with the
+ * complete value. If the last fragment of a long write could not be recognized, the request completes after the
+ * central has been answered, and a rejection only keeps the old value.
+ */
+void binc_application_set_char_write_async_cb(Application *application, onLocalCharacteristicWriteAsync callback);
+
+/**
+ * Set the time after which an async request that was not completed is answered with BLUEZ_ERROR_FAILED.
+ * Default is 5000 ms.
+ */
+void binc_application_set_request_timeout(Application *application, guint timeout_ms);
+
+/**
+ * Complete a request successfully. Can be called from any thread, the reply is sent from the main loop.
+ * Every request must be completed exactly once with either binc_gatt_request_accept or binc_gatt_request_reject,
+ * also when it already timed out. The request is freed after the first completion, so it must not be used again.
+ *
+ * @param value for a read, the new value of the characteristic or NULL to answer with the current value.
+ * Ignored for a write, the written value is stored. Ownership is taken.
+ */
+void binc_gatt_request_accept(GattRequest *request, GBytes *value);
+
+/**
+ * Complete a request with an error (BLUEZ_ERROR_*). Can be called from any thread, and only once per request.
+ */
+void binc_gatt_request_reject(GattRequest *request, const char *error);
+
+/**
+ * Let centrals acquire a socket for the notifications of a characteristic (AcquireNotify) instead of using
+ * StartNotify. While a socket is acquired, notifications are written to it directly instead of being sent over DBus.
+ * The start/stop notify callbacks are called when the socket is acquired and closed.
+ *
+ * Must be called before the application is registered.
+ * @return 0 if successful, EINVAL if the characteristic does not exist
+ */
+int binc_application_set_char_acquire_notify(Application *application, const char *service_uuid,
+                                             const char *char_uuid, gboolean enabled);
+
+/**
+ * Let centrals acquire a socket for 'write without response' writes of a characteristic (AcquireWrite).
+ * Writes are read from the socket in batches and passed to the write callback one by one.
+ *
+ * Must be called before the application is registered.
+ * @return 0 if successful, EINVAL if the characteristic does not exist
+ */
+int binc_application_set_char_acquire_write(Application *application, const char *service_uuid,
+                                            const char *char_uuid, gboolean enabled);
+
+/**
+ * Set the maximum size of a value that a central can write with a long (prepared) write. Default is 4096 bytes.
+ *
+ * The fragments of a long write are reassembled per central and characteristic, and the write callback is called
+ * once with the complete value and offset 0. Until then the stored value is not changed. Larger writes are rejected
+ * with BLUEZ_ERROR_INVALID_VALUE_LENGTH.
+ */
+void binc_application_set_max_long_write_length(Application *application, guint max_length);
+
 void binc_application_set_char_updated_cb(Application *application, onLocalCharacteristicUpdated callback);
 
 void binc_application_set_char_start_notify_cb(Application *application, onLocalCharacteristicStartNotify callback);
 
 void binc_application_set_char_stop_notify_cb(Application *application, onLocalCharacteristicStopNotify callback);
 
+/**
+ * Set a callback for completed indications.
+ *
+ * For characteristics that indicate but can't notify, only one indication is outstanding at a time.
+ * Further values are queued until the central confirms the previous one or the confirm timeout expires.
+ */
+void binc_application_set_char_indication_complete_cb(Application *application,
+                                                     onLocalCharacteristicIndicationComplete callback);
+
+/**
+ * Set the time to wait for a central to confirm an indication. Default is 2000 ms.
+ */
+void binc_application_set_confirm_timeout(Application *application, guint timeout_ms);
+
+void binc_application_get_indication_stats(const Application *application, IndicationStats *stats);
+
 int binc_application_set_char_value(const Application *application, const char *service_uuid,
                                     const char *char_uuid, GByteArray *byteArray);
 
+/**
+ * Set the value of a characteristic without copying it
+ *
+ * @param bytes the new value, ownership is taken. It is shared with ReadValue replies and notifications.
+ * @return 0 if successful, EINVAL if the characteristic does not exist
+ */
+int binc_application_set_char_bytes(const Application *application, const char *service_uuid,
+                                    const char *char_uuid, GBytes *bytes);
+
 GByteArray *binc_application_get_char_value(const Application *application, const char *service_uuid,
                                             const char *char_uuid);
 
+/**
+ * Get the value of a characteristic without copying it
+ *
+ * @return the value, owned by the characteristic and valid until the value changes, or NULL if there is none
+ */
+GBytes *binc_application_get_char_bytes(const Application *application, const char *service_uuid,
+                                        const char *char_uuid);
+
 void binc_application_set_desc_read_cb(Application *application, onLocalDescriptorRead callback);
 
 void binc_application_set_desc_write_cb(Application *application, onLocalDescriptorWrite callback);
@@ -115,12 +326,98 @@ void binc_application_set_desc_write_cb(Application *application, onLocalDescrip
 int binc_application_set_desc_value(const Application *application, const char *service_uuid,
                                     const char *char_uuid, const char *desc_uuid, GByteArray *byteArray);
 
+/**
+ * Set the value of a descriptor without copying it, ownership of bytes is taken
+ */
+int binc_application_set_desc_bytes(const Application *application, const char *service_uuid,
+                                    const char *char_uuid, const char *desc_uuid, GBytes *bytes);
+
+/**
+ * Notify the value of a characteristic. Nothing is encoded or sent when no central is subscribed.
+ *
+ * @return 0 if successful or nobody is subscribed, EINVAL if the characteristic does not exist or sending failed
+ */
 int binc_application_notify(const Application *application, const char *service_uuid, const char *char_uuid,
                             const GByteArray *byteArray);
 
+/**
+ * Set the value of a characteristic and notify it, without copying it
+ *
+ * @param bytes the new value, ownership is taken
+ * @return 0 if successful, EINVAL if the characteristic does not exist or the signal could not be sent
+ */
+int binc_application_notify_bytes(const Application *application, const char *service_uuid, const char *char_uuid,
+                                  GBytes *bytes);
+
+/**
+ * Queue a notification to be sent with the next binc_application_flush_notifications. The value is copied.
+ * Notifications for characteristics without subscribers are not queued but counted as skipped.
+ *
+ * @return 0 if queued, EINVAL if the characteristic does not exist
+ */
+int binc_application_queue_notify(Application *application, const char *service_uuid, const char *char_uuid,
+                                  const GByteArray *byteArray);
+
+/**
+ * Send all queued notifications in one pass, in the order they were queued
+ *
+ * @return the number of notifications sent
+ */
+guint binc_application_flush_notifications(Application *application);
+
+guint binc_application_get_queued_notify_count(const Application *application);
+
+/**
+ * Get the MTU of a central, as reported by Bluez in its most recent read, write or acquire request
+ *
+ * @return the MTU or 0 if the central did not make a request yet
+ */
+guint16 binc_application_get_central_mtu(const Application *application, const char *address);
+
+void binc_application_get_notify_stats(const Application *application, NotifyStats *stats);
+
+/**
+ * Coalesce notifications of a characteristic so that only the newest value is sent.
+ *
+ * At most one notification is sent per interval. If a central acquired the notify socket, one is sent
+ * whenever the socket is writable instead. Updates that are replaced before they are sent are counted
+ * in NotifyStats.superseded.
+ *
+ * @param interval_ms the minimum time between notifications, 0 sends every update
+ * @return 0 on success, EINVAL if the characteristic does not exist
+ */
+int binc_application_set_char_coalescing(const Application *application, const char *service_uuid,
+                                         const char *char_uuid, guint interval_ms);
+
 gboolean binc_application_char_is_notifying(const Application *application, const char *service_uuid,
                                             const char *char_uuid);
 
+/*
+ * Variants that take the handle returned by binc_application_add_characteristic or binc_application_add_descriptor.
+ * They skip the UUID lookup, which makes them cheaper in a loop. They return -EINVAL for invalid handles, like
+ * the functions that add attributes.
+ */
+
+int binc_application_set_char_value_by_handle(const Application *application, int handle, GByteArray *byteArray);
+
+int binc_application_set_char_bytes_by_handle(const Application *application, int handle, GBytes *bytes);
+
+GByteArray *binc_application_get_char_value_by_handle(const Application *application, int handle);
+
+GBytes *binc_application_get_char_bytes_by_handle(const Application *application, int handle);
+
+int binc_application_set_desc_value_by_handle(const Application *application, int handle, GByteArray *byteArray);
+
+int binc_application_set_desc_bytes_by_handle(const Application *application, int handle, GBytes *bytes);
+
+int binc_application_notify_by_handle(const Application *application, int handle, const GByteArray *byteArray);
+
+int binc_application_notify_bytes_by_handle(const Application *application, int handle, GBytes *bytes);
+
+int binc_application_queue_notify_by_handle(Application *application, int handle, const GByteArray *byteArray);
+
+gboolean binc_application_char_is_notifying_by_handle(const Application *application, int handle);
+
 void binc_application_set_user_data(Application *application, void *user_data);
 
 void *binc_application_get_user_data(const Application *application);
@@ -0,0 +1,201 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "builder.h"
+#include <math.h>
+#include <string.h>
+
+// IEEE 11073 Reserved SFLOAT and FLOAT values
+#define SFLOAT_POSITIVE_INFINITY 0x07FE
+#define SFLOAT_NaN 0x07FF
+#define SFLOAT_NEGATIVE_INFINITY 0x0802
+#define SFLOAT_MAX_MANTISSA 2045
+#define FLOAT_POSITIVE_INFINITY 0x007FFFFE
+#define FLOAT_NaN 0x007FFFFF
+#define FLOAT_NEGATIVE_INFINITY 0x00800002
+#define FLOAT_MAX_MANTISSA 8388605
+
+void builder_init(Builder *builder, guint8 *data, guint capacity, int byteOrder) {
+    g_assert(builder != NULL);
+    g_assert(data != NULL || capacity == 0);
+
+    builder->data = data;
+    builder->capacity = capacity;
+    builder->offset = 0;
+    builder->byteOrder = byteOrder;
+    builder->error = FALSE;
+    builder->byteArray = NULL;
+    builder->start = 0;
+}
+
+void builder_init_byte_array(Builder *builder, GByteArray *byteArray, guint capacity, int byteOrder) {
+    g_assert(builder != NULL);
+    g_assert(byteArray != NULL);
+
+    guint start = byteArray->len;
+    g_byte_array_set_size(byteArray, start + capacity);
+    builder_init(builder, byteArray->data + start, capacity, byteOrder);
+    builder->byteArray = byteArray;
+    builder->start = start;
+}
+
+guint builder_finish(Builder *builder) {
+    g_assert(builder != NULL);
+
+    if (builder->byteArray != NULL) {
+        g_byte_array_set_size(builder->byteArray, builder->start + builder->offset);
+    }
+    return builder->offset;
+}
+
+/*
+ * Find the mantissa and base 10 exponent for a value, dropping decimals until the mantissa fits
+ */
+static gboolean encode_decimal(double value, int precision, gint32 max_mantissa, int min_exponent,
+                               int max_exponent, gint32 *mantissa, int *exponent) {
+    int e = CLAMP(-precision, min_exponent, max_exponent);
+    for (; e <= max_exponent; e++) {
+        double scaled = round(value / pow(10.0, e));
+        if (fabs(scaled) <= max_mantissa) {
+            *mantissa = (gint32) scaled;
+            *exponent = e;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void builder_put_sfloat(Builder *builder, double value, int precision) {
+    g_assert(builder != NULL);
+
+    gint32 mantissa;
+    int exponent;
+    guint16 raw;
+    if (isnan(value)) {
+        raw = SFLOAT_NaN;
+    } else if (!encode_decimal(value, precision, SFLOAT_MAX_MANTISSA, -8, 7, &mantissa, &exponent)) {
+        raw = value > 0 ? SFLOAT_POSITIVE_INFINITY : SFLOAT_NEGATIVE_INFINITY;
+    } else {
+        raw = (guint16) ((((guint32) exponent & 0xF) << 12) | ((guint32) mantissa & 0xFFF));
+    }
+    builder_put_uint16(builder, raw);
+}
+
+void builder_put_float(Builder *builder, double value, int precision) {
+    g_assert(builder != NULL);
+
+    gint32 mantissa;
+    int exponent;
+    guint32 raw;
+    if (isnan(value)) {
+        raw = FLOAT_NaN;
+    } else if (!encode_decimal(value, precision, FLOAT_MAX_MANTISSA, -128, 127, &mantissa, &exponent)) {
+        raw = value > 0 ? FLOAT_POSITIVE_INFINITY : FLOAT_NEGATIVE_INFINITY;
+    } else {
+        raw = (((guint32) exponent & 0xFF) << 24) | ((guint32) mantissa & 0xFFFFFF);
+    }
+    builder_put_uint32(builder, raw);
+}
+
+static guint16 float_to_half(float value) {
+    guint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    guint16 sign = (guint16) ((bits >> 16) & 0x8000);
+    int exponent = (int) ((bits >> 23) & 0xff);
+    guint32 fraction = bits & 0x7fffff;
+
+    if (exponent == 0xff) {
+        return (guint16) (sign | 0x7c00 | (fraction != 0 ? 0x200 : 0));
+    }
+
+    exponent = exponent - 127 + 15;
+    if (exponent >= 0x1f) {
+        return (guint16) (sign | 0x7c00);
+    }
+
+    if (exponent <= 0) {
+        // Subnormal or too small
+        if (exponent < -10) return sign;
+
+        fraction |= 0x800000;
+        guint shift = (guint) (14 - exponent);
+        guint32 half_fraction = fraction >> shift;
+        guint32 remainder = fraction & ((1u << shift) - 1);
+        guint32 halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_fraction & 1))) {
+            half_fraction++;
+        }
+        return (guint16) (sign | half_fraction);
+    }
+
+    // Round to nearest even, a carry into the exponent is fine and may round up to infinity
+    guint32 half = ((guint32) exponent << 10) | (fraction >> 13);
+    guint32 remainder = fraction & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return (guint16) (sign | half);
+}
+
+void builder_put_754half(Builder *builder, double value) {
+    g_assert(builder != NULL);
+    builder_put_uint16(builder, float_to_half((float) value));
+}
+
+void builder_put_754float(Builder *builder, double value) {
+    g_assert(builder != NULL);
+
+    float single = (float) value;
+    guint32 bits;
+    memcpy(&bits, &single, sizeof(bits));
+    builder_put_uint32(builder, bits);
+}
+
+void builder_put_date_time(Builder *builder, const ParserDateTime *date_time) {
+    g_assert(builder != NULL);
+    g_assert(date_time != NULL);
+
+    if (!builder_ensure(builder, 7)) return;
+
+    builder_put_uint16(builder, date_time->year);
+    builder_put_uint8(builder, date_time->month);
+    builder_put_uint8(builder, date_time->day);
+    builder_put_uint8(builder, date_time->hours);
+    builder_put_uint8(builder, date_time->minutes);
+    builder_put_uint8(builder, date_time->seconds);
+}
+
+void builder_put_string(Builder *builder, const char *string) {
+    g_assert(builder != NULL);
+    g_assert(string != NULL);
+
+    gsize length = strlen(string);
+    if (length > G_MAXUINT || !builder_ensure(builder, (guint) length)) {
+        builder->error = TRUE;
+        return;
+    }
+
+    memcpy(builder->data + builder->offset, string, length);
+    builder->offset += (guint) length;
+}
@@ -0,0 +1,188 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_BUILDER_H
+#define BINC_BUILDER_H
+
+#include <glib.h>
+#include <endian.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Builder that writes values into a buffer, the counterpart of Parser. It can live on the stack, see builder_init.
+ *
+ * Writing past the end of the buffer does not abort but sets the error flag and writes nothing.
+ * The flag is sticky, so a sequence of writes can be checked once at the end with builder_has_error.
+ */
+typedef struct builder_instance {
+    guint8 *data; // Borrowed
+    guint capacity;
+    guint offset;
+    int byteOrder;
+    gboolean error;
+    GByteArray *byteArray; // Borrowed, only set by builder_init_byte_array
+    guint start;
+} Builder;
+
+/**
+ * Initialize a builder that writes into a caller buffer
+ *
+ * @param builder the builder to initialize
+ * @param data the buffer to write to
+ * @param capacity the size of the buffer
+ * @param byteOrder either LITTLE_ENDIAN or BIG_ENDIAN
+ */
+void builder_init(Builder *builder, guint8 *data, guint capacity, int byteOrder);
+
+/**
+ * Initialize a builder that appends up to capacity bytes to a byte array.
+ * The array is grown once, call builder_finish to trim it to the bytes actually written.
+ */
+void builder_init_byte_array(Builder *builder, GByteArray *byteArray, guint capacity, int byteOrder);
+
+/**
+ * Trim the byte array of a builder created with builder_init_byte_array to the bytes written
+ *
+ * @return the number of bytes written
+ */
+guint builder_finish(Builder *builder);
+
+static inline gboolean builder_has_error(const Builder *builder) {
+    return builder->error;
+}
+
+static inline guint builder_get_length(const Builder *builder) {
+    return builder->offset;
+}
+
+/**
+ * Check that size bytes can be written, sets the error flag otherwise
+ */
+static inline gboolean builder_ensure(Builder *builder, guint size) {
+    if (builder->error || builder->capacity - builder->offset < size) {
+        builder->error = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static inline void builder_put_uint8(Builder *builder, guint8 value) {
+    if (!builder_ensure(builder, 1)) return;
+    builder->data[builder->offset++] = value;
+}
+
+static inline void builder_put_sint8(Builder *builder, gint8 value) {
+    builder_put_uint8(builder, (guint8) value);
+}
+
+static inline void builder_put_uint16(Builder *builder, guint16 value) {
+    if (!builder_ensure(builder, 2)) return;
+
+    guint8 *p = builder->data + builder->offset;
+    builder->offset += 2;
+    if (builder->byteOrder == LITTLE_ENDIAN) {
+        p[0] = (guint8) value;
+        p[1] = (guint8) (value >> 8);
+    } else {
+        p[0] = (guint8) (value >> 8);
+        p[1] = (guint8) value;
+    }
+}
+
+static inline void builder_put_sint16(Builder *builder, gint16 value) {
+    builder_put_uint16(builder, (guint16) value);
+}
+
+static inline void builder_put_uint24(Builder *builder, guint32 value) {
+    if (!builder_ensure(builder, 3)) return;
+
+    guint8 *p = builder->data + builder->offset;
+    builder->offset += 3;
+    if (builder->byteOrder == LITTLE_ENDIAN) {
+        p[0] = (guint8) value;
+        p[1] = (guint8) (value >> 8);
+        p[2] = (guint8) (value >> 16);
+    } else {
+        p[0] = (guint8) (value >> 16);
+        p[1] = (guint8) (value >> 8);
+        p[2] = (guint8) value;
+    }
+}
+
+static inline void builder_put_uint32(Builder *builder, guint32 value) {
+    if (!builder_ensure(builder, 4)) return;
+
+    guint8 *p = builder->data + builder->offset;
+    builder->offset += 4;
+    if (builder->byteOrder == LITTLE_ENDIAN) {
+        p[0] = (guint8) value;
+        p[1] = (guint8) (value >> 8);
+        p[2] = (guint8) (value >> 16);
+        p[3] = (guint8) (value >> 24);
+    } else {
+        p[0] = (guint8) (value >> 24);
+        p[1] = (guint8) (value >> 16);
+        p[2] = (guint8) (value >> 8);
+        p[3] = (guint8) value;
+    }
+}
+
+/**
+ * Write an IEEE 11073 SFLOAT
+ *
+ * @param value the value
+ * @param precision number of decimals to keep, reduced if the mantissa doesn't fit
+ */
+void builder_put_sfloat(Builder *builder, double value, int precision);
+
+/**
+ * Write an IEEE 11073 FLOAT
+ *
+ * @param value the value
+ * @param precision number of decimals to keep, reduced if the mantissa doesn't fit
+ */
+void builder_put_float(Builder *builder, double value, int precision);
+
+void builder_put_754half(Builder *builder, double value);
+
+void builder_put_754float(Builder *builder, double value);
+
+/**
+ * Write a Date Time (7 bytes)
+ */
+void builder_put_date_time(Builder *builder, const ParserDateTime *date_time);
+
+/**
+ * Write a string without terminating NUL
+ */
+void builder_put_string(Builder *builder, const char *string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_BUILDER_H
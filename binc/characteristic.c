@@ -21,6 +21,7 @@
  *
  */
 
+#include <math.h>
 #include "characteristic.h"
 #include "logger.h"
 #include "utility.h"
@@ -37,6 +38,13 @@ static const char *const CHARACTERISTIC_METHOD_START_NOTIFY = "StartNotify";
 static const char *const CHARACTERISTIC_PROPERTY_NOTIFYING = "Notifying";
 static const char *const CHARACTERISTIC_PROPERTY_VALUE = "Value";
 
+#define NOTIFICATION_STATS_WINDOW 32
+
+typedef struct binc_pending_notification {
+    GByteArray *value; // Owned
+    NotificationInfo info;
+} PendingNotification;
+
 typedef struct binc_write_data {
     GVariant *value;
     Characteristic *characteristic;
@@ -46,9 +54,10 @@ struct binc_characteristic {
     Device *device; // Borrowed
     Service *service; // Borrowed
     GDBusConnection *connection; // Borrowed
-    const char *path; // Owned
-    const char *uuid; // Owned
-    const char *service_path; // Owned
+    Arena *arena; // Owned reference
+    const char *path; // Owned by GATT arena
+    const char *uuid; // Owned by GATT arena
+    const char *service_path; // Owned by GATT arena
     gboolean notifying;
     GList *flags; // Owned
     guint properties;
@@ -59,7 +68,26 @@ struct binc_characteristic {
     OnNotifyingStateChangedCallback notify_state_callback;
     OnReadCallback on_read_callback;
     OnWriteCallback on_write_callback;
-    OnNotifyCallback on_notify_callback;
+    OnNotifyExtCallback on_notify_callback;
+
+    OnCharacteristicNotifyHandler notify_handler;
+    void *notify_handler_user_data; // Borrowed
+    OnCharacteristicReadHandler read_handler;
+    void *read_handler_user_data; // Borrowed
+    CharacteristicDecoder decoder;
+    GDestroyNotify decoded_free;
+    const Decoder *value_decoder; // Borrowed
+
+    NotificationInfo received_info;
+    NotificationInfo delivered_info;
+    guint64 notification_count;
+    gint64 notification_intervals[NOTIFICATION_STATS_WINDOW];
+
+    NotifyDeliveryPolicy delivery_policy;
+    guint max_queue_length;
+    GQueue *pending_notifications; // Owned
+    guint delivery_idle;
+    DeliveryStats delivery_stats;
 };
 
 Characteristic *binc_characteristic_create(Device *device, const char *path) {
@@ -67,14 +95,21 @@ Characteristic *binc_characteristic_create(Device *device, const char *path) {
     g_assert(path != NULL);
     g_assert(strlen(path) > 0);
 
-    Characteristic *characteristic = g_new0(Characteristic, 1);
+    Arena *arena = binc_device_get_gatt_arena(device);
+    Characteristic *characteristic = binc_arena_new0(arena, Characteristic);
     characteristic->device = device;
     characteristic->connection = binc_device_get_dbus_connection(device);
-    characteristic->path = g_strdup(path);
+    characteristic->arena = binc_arena_ref(arena);
+    characteristic->path = binc_arena_strdup(arena, path);
     characteristic->mtu = 23;
     return characteristic;
 }
 
+static void binc_pending_notification_free(PendingNotification *pending) {
+    g_byte_array_free(pending->value, TRUE);
+    g_free(pending);
+}
+
 void binc_characteristic_free(Characteristic *characteristic) {
     g_assert(characteristic != NULL);
 
@@ -83,6 +118,16 @@ void binc_characteristic_free(Characteristic *characteristic) {
         characteristic->characteristic_prop_changed = 0;
     }
 
+    if (characteristic->delivery_idle != 0) {
+        g_source_remove(characteristic->delivery_idle);
+        characteristic->delivery_idle = 0;
+    }
+
+    if (characteristic->pending_notifications != NULL) {
+        g_queue_free_full(characteristic->pending_notifications, (GDestroyNotify) binc_pending_notification_free);
+        characteristic->pending_notifications = NULL;
+    }
+
     if (characteristic->flags != NULL) {
         g_list_free_full(characteristic->flags, g_free);
         characteristic->flags = NULL;
@@ -93,19 +138,17 @@ void binc_characteristic_free(Characteristic *characteristic) {
         characteristic->descriptors = NULL;
     }
 
-    g_free((char *) characteristic->uuid);
     characteristic->uuid = NULL;
-
-    g_free((char *) characteristic->path);
     characteristic->path = NULL;
-
-    g_free((char *) characteristic->service_path);
     characteristic->service_path = NULL;
-
     characteristic->device = NULL;
     characteristic->connection = NULL;
     characteristic->service = NULL;
-    g_free(characteristic);
+
+    // The struct and its strings live in the arena, so this must be the last thing we do
+    Arena *arena = characteristic->arena;
+    characteristic->arena = NULL;
+    binc_arena_unref(arena);
 }
 
 char *binc_characteristic_to_string(const Characteristic *characteristic) {
@@ -132,6 +175,27 @@ char *binc_characteristic_to_string(const Characteristic *characteristic) {
     return result;
 }
 
+static void *binc_internal_char_decode(const Characteristic *characteristic, const GByteArray *byteArray,
+                                       DecodedValue *storage) {
+    if (byteArray == NULL) return NULL;
+
+    if (characteristic->value_decoder != NULL) {
+        return binc_decoder_decode(characteristic->value_decoder, byteArray, storage) ? storage : NULL;
+    }
+
+    if (characteristic->decoder == NULL) return NULL;
+    return characteristic->decoder(characteristic, byteArray);
+}
+
+static void binc_internal_char_free_decoded(const Characteristic *characteristic, void *decoded) {
+    // Values from a value decoder live on the stack of the caller
+    if (characteristic->value_decoder != NULL) return;
+
+    if (decoded != NULL && characteristic->decoded_free != NULL) {
+        characteristic->decoded_free(decoded);
+    }
+}
+
 static void binc_internal_char_read_cb(__attribute__((unused)) GObject *source_object,
                                        GAsyncResult *res,
                                        gpointer user_data) {
@@ -148,7 +212,13 @@ static void binc_internal_char_read_cb(__attribute__((unused)) GObject *source_o
         byteArray = g_variant_get_byte_array(innerArray);
     }
 
-    if (characteristic->on_read_callback != NULL) {
+    if (characteristic->read_handler != NULL) {
+        DecodedValue storage;
+        void *decoded = binc_internal_char_decode(characteristic, byteArray, &storage);
+        characteristic->read_handler(characteristic, byteArray, decoded, error,
+                                     characteristic->read_handler_user_data);
+        binc_internal_char_free_decoded(characteristic, decoded);
+    } else if (characteristic->on_read_callback != NULL) {
         characteristic->on_read_callback(characteristic->device, characteristic, byteArray, error);
     }
 
@@ -271,6 +341,74 @@ void binc_characteristic_write(Characteristic *characteristic, const GByteArray
                            writeData);
 }
 
+static void binc_internal_char_update_notification_stats(Characteristic *characteristic, gint64 received) {
+    if (characteristic->notification_count > 0) {
+        guint64 index = (characteristic->notification_count - 1) % NOTIFICATION_STATS_WINDOW;
+        characteristic->notification_intervals[index] = received - characteristic->received_info.received_us;
+    }
+    characteristic->notification_count++;
+    characteristic->received_info.received_us = received;
+    characteristic->received_info.sequence++;
+}
+
+static void binc_internal_char_deliver_notification(Characteristic *characteristic, const GByteArray *byteArray,
+                                                    const NotificationInfo *info) {
+    characteristic->delivered_info = *info;
+    characteristic->delivery_stats.delivered++;
+
+    if (characteristic->notify_handler != NULL) {
+        DecodedValue storage;
+        void *decoded = binc_internal_char_decode(characteristic, byteArray, &storage);
+        characteristic->notify_handler(characteristic, byteArray, decoded,
+                                       characteristic->notify_handler_user_data);
+        binc_internal_char_free_decoded(characteristic, decoded);
+    } else if (characteristic->on_notify_callback != NULL) {
+        characteristic->on_notify_callback(characteristic->device, characteristic, byteArray,
+                                           &characteristic->delivered_info);
+    }
+}
+
+static gboolean binc_internal_char_deliver_pending(gpointer user_data) {
+    Characteristic *characteristic = (Characteristic *) user_data;
+    g_assert(characteristic != NULL);
+
+    // Deliver one notification per iteration so incoming signals are handled (and dropped) in between
+    PendingNotification *pending = g_queue_pop_head(characteristic->pending_notifications);
+    if (pending != NULL) {
+        binc_internal_char_deliver_notification(characteristic, pending->value, &pending->info);
+        binc_pending_notification_free(pending);
+    }
+
+    if (g_queue_is_empty(characteristic->pending_notifications)) {
+        characteristic->delivery_idle = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void binc_internal_char_queue_notification(Characteristic *characteristic, const GByteArray *byteArray) {
+    GQueue *queue = characteristic->pending_notifications;
+    guint max_length = characteristic->delivery_policy == BINC_DELIVERY_LATEST_WINS ?
+                       1 : characteristic->max_queue_length;
+
+    while (g_queue_get_length(queue) >= max_length) {
+        binc_pending_notification_free(g_queue_pop_head(queue));
+        characteristic->delivery_stats.dropped++;
+    }
+
+    PendingNotification *pending = g_new0(PendingNotification, 1);
+    pending->value = g_byte_array_sized_new(byteArray->len);
+    g_byte_array_append(pending->value, byteArray->data, byteArray->len);
+    pending->info = characteristic->received_info;
+    g_queue_push_tail(queue, pending);
+
+    characteristic->delivery_stats.max_queue_depth = MAX(characteristic->delivery_stats.max_queue_depth,
+                                                         g_queue_get_length(queue));
+    if (characteristic->delivery_idle == 0) {
+        characteristic->delivery_idle = g_idle_add(binc_internal_char_deliver_pending, characteristic);
+    }
+}
+
 static void binc_internal_signal_characteristic_changed(__attribute__((unused)) GDBusConnection *conn,
                                                         __attribute__((unused)) const gchar *sender,
                                                         __attribute__((unused)) const gchar *path,
@@ -279,6 +417,9 @@ static void binc_internal_signal_characteristic_changed(__attribute__((unused))
                                                         GVariant *parameters,
                                                         void *user_data) {
 
+    // Take the receive time before doing anything else
+    gint64 received = g_get_monotonic_time();
+
     Characteristic *characteristic = (Characteristic *) user_data;
     g_assert(characteristic != NULL);
 
@@ -312,8 +453,11 @@ static void binc_internal_signal_characteristic_changed(__attribute__((unused))
             log_debug(TAG, "notification <%s> on <%s>", result->str, characteristic->uuid);
             g_string_free(result, TRUE);
 
-            if (characteristic->on_notify_callback != NULL) {
-                characteristic->on_notify_callback(characteristic->device, characteristic, byteArray);
+            binc_internal_char_update_notification_stats(characteristic, received);
+            if (characteristic->delivery_policy == BINC_DELIVERY_UNBOUNDED) {
+                binc_internal_char_deliver_notification(characteristic, byteArray, &characteristic->received_info);
+            } else {
+                binc_internal_char_queue_notification(characteristic, byteArray);
             }
             g_byte_array_free(byteArray, FALSE);
         }
@@ -437,12 +581,125 @@ void binc_characteristic_set_write_cb(Characteristic *characteristic, OnWriteCal
     characteristic->on_write_callback = callback;
 }
 
-void binc_characteristic_set_notify_cb(Characteristic *characteristic, OnNotifyCallback callback) {
+void binc_characteristic_set_notify_cb(Characteristic *characteristic, OnNotifyExtCallback callback) {
     g_assert(characteristic != NULL);
     g_assert(callback != NULL);
     characteristic->on_notify_callback = callback;
 }
 
+const NotificationInfo *binc_characteristic_get_notification_info(const Characteristic *characteristic) {
+    g_assert(characteristic != NULL);
+    return &characteristic->delivered_info;
+}
+
+void binc_characteristic_get_notification_stats(const Characteristic *characteristic, NotificationStats *stats) {
+    g_assert(characteristic != NULL);
+    g_assert(stats != NULL);
+
+    memset(stats, 0, sizeof(NotificationStats));
+    stats->count = characteristic->notification_count;
+    stats->last_received_us = characteristic->received_info.received_us;
+    if (characteristic->notification_count < 2) return;
+
+    guint window = (guint) MIN(characteristic->notification_count - 1, NOTIFICATION_STATS_WINDOW);
+    gint64 sum = 0;
+    for (guint i = 0; i < window; i++) {
+        gint64 interval = characteristic->notification_intervals[i];
+        sum += interval;
+        stats->max_interval_us = MAX(stats->max_interval_us, interval);
+    }
+    double mean = (double) sum / window;
+
+    double sum_of_squares = 0;
+    for (guint i = 0; i < window; i++) {
+        double deviation = (double) characteristic->notification_intervals[i] - mean;
+        sum_of_squares += deviation * deviation;
+    }
+
+    stats->window = window;
+    stats->mean_interval_us = (gint64) mean;
+    stats->jitter_us = (gint64) sqrt(sum_of_squares / window);
+}
+
+void binc_characteristic_reset_notification_stats(Characteristic *characteristic) {
+    g_assert(characteristic != NULL);
+
+    // The sequence number is not reset so gaps remain detectable
+    characteristic->notification_count = 0;
+    memset(characteristic->notification_intervals, 0, sizeof(characteristic->notification_intervals));
+}
+
+void binc_characteristic_set_delivery_policy(Characteristic *characteristic, NotifyDeliveryPolicy policy,
+                                            guint max_queue_length) {
+    g_assert(characteristic != NULL);
+    g_assert(policy != BINC_DELIVERY_DROP_OLDEST || max_queue_length > 0);
+
+    characteristic->delivery_policy = policy;
+    characteristic->max_queue_length = max_queue_length;
+    if (policy != BINC_DELIVERY_UNBOUNDED && characteristic->pending_notifications == NULL) {
+        characteristic->pending_notifications = g_queue_new();
+    }
+}
+
+NotifyDeliveryPolicy binc_characteristic_get_delivery_policy(const Characteristic *characteristic) {
+    g_assert(characteristic != NULL);
+    return characteristic->delivery_policy;
+}
+
+void binc_characteristic_get_delivery_stats(const Characteristic *characteristic, DeliveryStats *stats) {
+    g_assert(characteristic != NULL);
+    g_assert(stats != NULL);
+
+    *stats = characteristic->delivery_stats;
+    stats->queue_depth = characteristic->pending_notifications != NULL ?
+                         g_queue_get_length(characteristic->pending_notifications) : 0;
+}
+
+void binc_characteristic_set_notify_handler(Characteristic *characteristic,
+                                            OnCharacteristicNotifyHandler handler,
+                                            void *user_data) {
+    g_assert(characteristic != NULL);
+    characteristic->notify_handler = handler;
+    characteristic->notify_handler_user_data = user_data;
+}
+
+void binc_characteristic_set_read_handler(Characteristic *characteristic,
+                                          OnCharacteristicReadHandler handler,
+                                          void *user_data) {
+    g_assert(characteristic != NULL);
+    characteristic->read_handler = handler;
+    characteristic->read_handler_user_data = user_data;
+}
+
+void binc_characteristic_set_decoder(Characteristic *characteristic,
+                                     CharacteristicDecoder decoder,
+                                     GDestroyNotify decoded_free) {
+    g_assert(characteristic != NULL);
+    characteristic->decoder = decoder;
+    characteristic->decoded_free = decoded_free;
+    characteristic->value_decoder = NULL;
+}
+
+void binc_characteristic_set_value_decoder(Characteristic *characteristic, const Decoder *decoder) {
+    g_assert(characteristic != NULL);
+    characteristic->value_decoder = decoder;
+    characteristic->decoder = NULL;
+    characteristic->decoded_free = NULL;
+}
+
+gboolean binc_characteristic_use_standard_decoder(Characteristic *characteristic) {
+    g_assert(characteristic != NULL);
+    g_assert(characteristic->uuid != NULL);
+
+    const Decoder *decoder = binc_decoder_lookup_by_uuid(characteristic->uuid);
+    if (decoder == NULL) {
+        log_debug(TAG, "no decoder for <%s>", characteristic->uuid);
+        return FALSE;
+    }
+    binc_characteristic_set_value_decoder(characteristic, decoder);
+    return TRUE;
+}
+
 void binc_characteristic_set_notifying_state_change_cb(Characteristic *characteristic,
                                                        OnNotifyingStateChangedCallback callback) {
     g_assert(characteristic != NULL);
@@ -469,8 +726,10 @@ void binc_characteristic_set_uuid(Characteristic *characteristic, const char *uu
     g_assert(characteristic != NULL);
     g_assert(uuid != NULL);
 
-    g_free((char *) characteristic->uuid);
-    characteristic->uuid = g_strdup(uuid);
+    // Strings can't be freed individually so only copy when the value changes
+    if (characteristic->uuid == NULL || !g_str_equal(characteristic->uuid, uuid)) {
+        characteristic->uuid = binc_arena_strdup(characteristic->arena, uuid);
+    }
 }
 
 void binc_characteristic_set_mtu(Characteristic *characteristic, guint mtu) {
@@ -503,10 +762,9 @@ void binc_characteristic_set_service_path(Characteristic *characteristic, const
     g_assert(characteristic != NULL);
     g_assert(service_path != NULL);
 
-    if (characteristic->service_path != NULL) {
-        g_free((char *) characteristic->service_path);
+    if (characteristic->service_path == NULL || !g_str_equal(characteristic->service_path, service_path)) {
+        characteristic->service_path = binc_arena_strdup(characteristic->arena, service_path);
     }
-    characteristic->service_path = g_strdup(service_path);
 }
 
 GList *binc_characteristic_get_flags(const Characteristic *characteristic) {
@@ -592,6 +850,18 @@ void binc_characteristic_add_descriptor(Characteristic *characteristic, Descript
     characteristic->descriptors = g_list_append(characteristic->descriptors, descriptor);
 }
 
+void binc_characteristic_remove_descriptor(Characteristic *characteristic, Descriptor *descriptor) {
+    g_assert(characteristic != NULL);
+    g_assert(descriptor != NULL);
+
+    characteristic->descriptors = g_list_remove(characteristic->descriptors, descriptor);
+}
+
+const char *binc_characteristic_get_path(const Characteristic *characteristic) {
+    g_assert(characteristic != NULL);
+    return characteristic->path;
+}
+
 Descriptor *binc_characteristic_get_descriptor(const Characteristic *characteristic, const char* desc_uuid) {
     g_assert(characteristic != NULL);
     g_assert(is_valid_uuid(desc_uuid));
@@ -26,6 +26,7 @@
 
 #include <gio/gio.h>
 #include "service.h"
+#include "decoder.h"
 #include "forward_decl.h"
 
 #ifdef __cplusplus
@@ -69,10 +70,67 @@ typedef void (*OnNotifyingStateChangedCallback)(Device *device, Characteristic *
 
 typedef void (*OnNotifyCallback)(Device *device, Characteristic *characteristic, const GByteArray *byteArray);
 
+/**
+ * Receive information of a notification
+ */
+typedef struct binc_notification_info {
+    gint64 received_us; // CLOCK_MONOTONIC time in microseconds at which the notification reached the library
+    guint32 sequence; // Per characteristic, starts at 1 when received, so gaps only show delivery policy drops
+} NotificationInfo;
+
+typedef void (*OnNotifyExtCallback)(Device *device, Characteristic *characteristic, const GByteArray *byteArray,
+                                    const NotificationInfo *info);
+
+/**
+ * How notifications are handed to the application
+ *
+ * BINC_DELIVERY_UNBOUNDED: deliver immediately from the D-Bus signal handler (default)
+ * BINC_DELIVERY_DROP_OLDEST: queue up to max_queue_length notifications and drop the oldest when full
+ * BINC_DELIVERY_LATEST_WINS: only keep the most recent notification that has not been delivered yet
+ *
+ * Queued notifications are delivered from an idle source, so incoming signals keep being processed
+ * while the application is slow to handle them.
+ */
+typedef enum NotifyDeliveryPolicy {
+    BINC_DELIVERY_UNBOUNDED = 0, BINC_DELIVERY_DROP_OLDEST = 1, BINC_DELIVERY_LATEST_WINS = 2
+} NotifyDeliveryPolicy;
+
+typedef struct binc_delivery_stats {
+    guint queue_depth;
+    guint max_queue_depth;
+    guint64 delivered;
+    guint64 dropped;
+} DeliveryStats;
+
+/**
+ * Inter-arrival statistics of notifications over the last intervals (at most 32)
+ */
+typedef struct binc_notification_stats {
+    guint64 count;
+    guint window;
+    gint64 mean_interval_us;
+    gint64 jitter_us; // Standard deviation of the intervals in the window
+    gint64 max_interval_us;
+    gint64 last_received_us;
+} NotificationStats;
+
 typedef void (*OnReadCallback)(Device *device, Characteristic *characteristic, const GByteArray *byteArray, const GError *error);
 
 typedef void (*OnWriteCallback)(Device *device, Characteristic *characteristic, const GByteArray *byteArray, const GError *error);
 
+/**
+ * Optional decoder that turns the raw bytes of a characteristic into a typed value.
+ * The returned value is handed to the characteristic's handler and released afterwards with the
+ * GDestroyNotify passed to binc_characteristic_set_decoder.
+ */
+typedef void *(*CharacteristicDecoder)(const Characteristic *characteristic, const GByteArray *byteArray);
+
+typedef void (*OnCharacteristicNotifyHandler)(Characteristic *characteristic, const GByteArray *byteArray,
+                                              void *decoded, void *user_data);
+
+typedef void (*OnCharacteristicReadHandler)(Characteristic *characteristic, const GByteArray *byteArray,
+                                            void *decoded, const GError *error, void *user_data);
+
 
 void binc_characteristic_read(Characteristic *characteristic);
 
@@ -104,6 +162,81 @@ Descriptor *binc_characteristic_get_descriptor(const Characteristic *characteris
 
 GList *binc_characteristic_get_descriptors(const Characteristic *characteristic);
 
+/**
+ * Get the receive information of the notification that is being delivered, can be used from within notify handlers
+ */
+const NotificationInfo *binc_characteristic_get_notification_info(const Characteristic *characteristic);
+
+void binc_characteristic_get_notification_stats(const Characteristic *characteristic, NotificationStats *stats);
+
+void binc_characteristic_reset_notification_stats(Characteristic *characteristic);
+
+/**
+ * Set the notification delivery policy of the characteristic
+ *
+ * @param characteristic the characteristic
+ * @param policy the policy
+ * @param max_queue_length maximum number of queued notifications for BINC_DELIVERY_DROP_OLDEST, ignored otherwise
+ */
+void binc_characteristic_set_delivery_policy(Characteristic *characteristic, NotifyDeliveryPolicy policy,
+                                            guint max_queue_length);
+
+NotifyDeliveryPolicy binc_characteristic_get_delivery_policy(const Characteristic *characteristic);
+
+void binc_characteristic_get_delivery_stats(const Characteristic *characteristic, DeliveryStats *stats);
+
+/**
+ * Set a handler for notifications/indications of this characteristic only.
+ * When set, it is called instead of the device-wide notify callback.
+ *
+ * @param characteristic the characteristic
+ * @param handler the handler to call, or NULL to fall back to the device-wide callback
+ * @param user_data passed to the handler, not owned by the characteristic
+ */
+void binc_characteristic_set_notify_handler(Characteristic *characteristic,
+                                            OnCharacteristicNotifyHandler handler,
+                                            void *user_data);
+
+/**
+ * Set a handler for reads of this characteristic only.
+ * When set, it is called instead of the device-wide read callback.
+ *
+ * @param characteristic the characteristic
+ * @param handler the handler to call, or NULL to fall back to the device-wide callback
+ * @param user_data passed to the handler, not owned by the characteristic
+ */
+void binc_characteristic_set_read_handler(Characteristic *characteristic,
+                                          OnCharacteristicReadHandler handler,
+                                          void *user_data);
+
+/**
+ * Set a decoder that is run before the characteristic's notify/read handler is called
+ *
+ * @param characteristic the characteristic
+ * @param decoder the decoder, or NULL to pass the raw bytes only
+ * @param decoded_free used to free the decoded value after the handler returns, may be NULL
+ */
+void binc_characteristic_set_decoder(Characteristic *characteristic,
+                                     CharacteristicDecoder decoder,
+                                     GDestroyNotify decoded_free);
+
+/**
+ * Decode values with a decoder from the decoder registry instead of a CharacteristicDecoder.
+ * The handler receives a pointer to the decoded struct, which is only valid during the call,
+ * or NULL if the value was malformed.
+ *
+ * @param characteristic the characteristic
+ * @param decoder the decoder, or NULL to pass the raw bytes only
+ */
+void binc_characteristic_set_value_decoder(Characteristic *characteristic, const Decoder *decoder);
+
+/**
+ * Look up the registered decoder for the UUID of the characteristic and use it
+ *
+ * @return TRUE if a decoder was found
+ */
+gboolean binc_characteristic_use_standard_decoder(Characteristic *characteristic);
+
 /**
  * Get a string representation of the characteristic
  * @param characteristic
@@ -38,7 +38,7 @@ void binc_characteristic_set_read_cb(Characteristic *characteristic, OnReadCallb
 
 void binc_characteristic_set_write_cb(Characteristic *characteristic, OnWriteCallback callback);
 
-void binc_characteristic_set_notify_cb(Characteristic *characteristic, OnNotifyCallback callback);
+void binc_characteristic_set_notify_cb(Characteristic *characteristic, OnNotifyExtCallback callback);
 
 void binc_characteristic_set_notifying_state_change_cb(Characteristic *characteristic,
                                                        OnNotifyingStateChangedCallback callback);
@@ -59,6 +59,10 @@ const char *binc_characteristic_get_service_path(const Characteristic *character
 
 void binc_characteristic_add_descriptor(Characteristic *characteristic, Descriptor *descriptor);
 
+void binc_characteristic_remove_descriptor(Characteristic *characteristic, Descriptor *descriptor);
+
+const char *binc_characteristic_get_path(const Characteristic *characteristic);
+
 #ifdef __cplusplus
 }
 #endif
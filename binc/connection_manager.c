@@ -0,0 +1,386 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "connection_manager.h"
+#include "connection_manager_internal.h"
+#include "adapter.h"
+#include "device.h"
+#include "logger.h"
+
+static const char *const TAG = "ConnectionManager";
+
+static const guint DEFAULT_MAX_CONNECTING = 2;
+static const guint DEFAULT_INITIAL_DELAY_MS = 500;
+static const guint DEFAULT_MAX_DELAY_MS = 30000;
+
+typedef enum ConnectionRequestState {
+    REQUEST_QUEUED = 0, REQUEST_CONNECTING = 1, REQUEST_BACKOFF = 2, REQUEST_CONNECTED = 3, REQUEST_FAILED = 4
+} ConnectionRequestState;
+
+typedef struct binc_connection_request {
+    ConnectionManager *manager; // Borrowed
+    const char *path; // Owned
+    guint8 priority_class;
+    ConnectionRequestState state;
+    guint consecutive_failures;
+    guint retry_timer;
+    gint64 connect_started;
+    gint64 total_latency_us;
+    ConnectionStats stats;
+} ConnectionRequest;
+
+struct binc_connection_manager {
+    Adapter *adapter; // Borrowed
+    GHashTable *requests; // Owned
+    guint max_connecting;
+    guint initial_delay_ms;
+    guint max_delay_ms;
+    guint max_attempts;
+    guint dispatch_idle_id;
+};
+
+static void binc_connection_request_free(ConnectionRequest *request) {
+    g_assert(request != NULL);
+
+    if (request->retry_timer != 0) {
+        g_source_remove(request->retry_timer);
+        request->retry_timer = 0;
+    }
+
+    g_free((char *) request->path);
+    request->path = NULL;
+    request->manager = NULL;
+    g_free(request);
+}
+
+ConnectionManager *binc_connection_manager_create(Adapter *adapter) {
+    g_assert(adapter != NULL);
+
+    ConnectionManager *manager = g_new0(ConnectionManager, 1);
+    manager->adapter = adapter;
+    manager->requests = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                              (GDestroyNotify) binc_connection_request_free);
+    manager->max_connecting = DEFAULT_MAX_CONNECTING;
+    manager->initial_delay_ms = DEFAULT_INITIAL_DELAY_MS;
+    manager->max_delay_ms = DEFAULT_MAX_DELAY_MS;
+    manager->max_attempts = 0;
+    return manager;
+}
+
+void binc_connection_manager_free(ConnectionManager *manager) {
+    g_assert(manager != NULL);
+
+    if (manager->dispatch_idle_id != 0) {
+        g_source_remove(manager->dispatch_idle_id);
+        manager->dispatch_idle_id = 0;
+    }
+
+    if (manager->requests != NULL) {
+        g_hash_table_destroy(manager->requests);
+        manager->requests = NULL;
+    }
+
+    manager->adapter = NULL;
+    g_free(manager);
+}
+
+guint binc_connection_manager_get_connecting_count(const ConnectionManager *manager) {
+    g_assert(manager != NULL);
+
+    guint count = 0;
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, manager->requests);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (((ConnectionRequest *) value)->state == REQUEST_CONNECTING) count++;
+    }
+    return count;
+}
+
+guint binc_connection_manager_get_queued_count(const ConnectionManager *manager) {
+    g_assert(manager != NULL);
+
+    guint count = 0;
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, manager->requests);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        ConnectionRequestState state = ((ConnectionRequest *) value)->state;
+        if (state == REQUEST_QUEUED || state == REQUEST_BACKOFF) count++;
+    }
+    return count;
+}
+
+/**
+ * Returns TRUE if candidate should be connected before current
+ */
+static gboolean binc_internal_has_precedence(const ConnectionRequest *candidate, short candidate_rssi,
+                                             const ConnectionRequest *current, short current_rssi) {
+    if (current == NULL) return TRUE;
+    if (candidate->priority_class != current->priority_class) {
+        return candidate->priority_class > current->priority_class;
+    }
+    return candidate_rssi > current_rssi;
+}
+
+static void binc_internal_start_connecting(ConnectionRequest *request, Device *device) {
+    request->state = REQUEST_CONNECTING;
+    request->connect_started = g_get_monotonic_time();
+    request->stats.attempts++;
+
+    log_debug(TAG, "connecting '%s' (attempt %d, class %d)", binc_device_get_address(device),
+              request->consecutive_failures + 1, request->priority_class);
+    binc_device_connect(device);
+}
+
+static void binc_internal_dispatch(ConnectionManager *manager) {
+    guint connecting = binc_connection_manager_get_connecting_count(manager);
+
+    while (connecting < manager->max_connecting) {
+        ConnectionRequest *best = NULL;
+        Device *best_device = NULL;
+        short best_rssi = 0;
+
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, manager->requests);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            ConnectionRequest *request = (ConnectionRequest *) value;
+            if (request->state != REQUEST_QUEUED) continue;
+
+            Device *device = binc_adapter_get_device_by_path(manager->adapter, request->path);
+            if (device == NULL) {
+                // Device was removed, wait until it is rediscovered
+                continue;
+            }
+
+            ConnectionState connection_state = binc_device_get_connection_state(device);
+            if (connection_state == BINC_CONNECTED) {
+                request->state = REQUEST_CONNECTED;
+                continue;
+            }
+
+            // Wait for the device to reach the DISCONNECTED state before connecting
+            if (connection_state != BINC_DISCONNECTED) continue;
+
+            short rssi = binc_device_get_rssi(device);
+            if (binc_internal_has_precedence(request, rssi, best, best_rssi)) {
+                best = request;
+                best_device = device;
+                best_rssi = rssi;
+            }
+        }
+
+        if (best == NULL) break;
+
+        binc_internal_start_connecting(best, best_device);
+        connecting++;
+    }
+}
+
+static gboolean binc_internal_dispatch_idle_cb(gpointer user_data) {
+    ConnectionManager *manager = (ConnectionManager *) user_data;
+    g_assert(manager != NULL);
+
+    manager->dispatch_idle_id = 0;
+    binc_internal_dispatch(manager);
+    return FALSE;
+}
+
+/**
+ * Dispatch from the mainloop instead of from a device state change, so a new Connect is not issued
+ * before the application has seen the state change
+ */
+static void binc_internal_schedule_dispatch(ConnectionManager *manager) {
+    if (manager->dispatch_idle_id == 0) {
+        manager->dispatch_idle_id = g_idle_add(binc_internal_dispatch_idle_cb, manager);
+    }
+}
+
+static gboolean binc_internal_retry_cb(gpointer user_data) {
+    ConnectionRequest *request = (ConnectionRequest *) user_data;
+    g_assert(request != NULL);
+
+    request->retry_timer = 0;
+    request->state = REQUEST_QUEUED;
+    binc_internal_dispatch(request->manager);
+    return FALSE;
+}
+
+static guint binc_internal_backoff_delay(const ConnectionManager *manager, guint consecutive_failures) {
+    guint delay = manager->initial_delay_ms;
+    for (guint i = 1; i < consecutive_failures && delay < manager->max_delay_ms; i++) {
+        delay *= 2;
+    }
+    delay = MIN(delay, manager->max_delay_ms);
+
+    // Equal jitter: keep half of the delay and randomize the other half
+    guint half = delay / 2;
+    return half + (guint) g_random_int_range(0, (gint32) (delay - half) + 1);
+}
+
+static void binc_internal_handle_failure(ConnectionManager *manager, ConnectionRequest *request,
+                                         const GError *error) {
+    request->stats.failures++;
+    request->consecutive_failures++;
+
+    if (manager->max_attempts > 0 && request->consecutive_failures >= manager->max_attempts) {
+        log_info(TAG, "giving up on '%s' after %d attempts", request->path, request->consecutive_failures);
+        request->state = REQUEST_FAILED;
+        return;
+    }
+
+    guint delay = binc_internal_backoff_delay(manager, request->consecutive_failures);
+    log_debug(TAG, "connecting '%s' failed (%s), retrying in %d ms", request->path,
+              error != NULL ? error->message : "disconnected", delay);
+    request->state = REQUEST_BACKOFF;
+    request->retry_timer = g_timeout_add(delay, binc_internal_retry_cb, request);
+}
+
+static void binc_internal_handle_success(ConnectionRequest *request) {
+    gint64 latency = g_get_monotonic_time() - request->connect_started;
+    ConnectionStats *stats = &request->stats;
+
+    stats->successes++;
+    stats->last_latency_us = latency;
+    if (stats->successes == 1 || latency < stats->min_latency_us) stats->min_latency_us = latency;
+    if (latency > stats->max_latency_us) stats->max_latency_us = latency;
+    request->total_latency_us += latency;
+    stats->mean_latency_us = request->total_latency_us / stats->successes;
+
+    request->consecutive_failures = 0;
+    log_debug(TAG, "connected '%s' in %ld ms", request->path, (long) (latency / 1000));
+}
+
+void binc_connection_manager_device_state_changed(ConnectionManager *manager, Device *device,
+                                                  ConnectionState state, const GError *error) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+
+    ConnectionRequest *request = g_hash_table_lookup(manager->requests, binc_device_get_path(device));
+    if (request == NULL) return;
+
+    if (state == BINC_CONNECTED) {
+        if (request->state == REQUEST_CONNECTING) {
+            binc_internal_handle_success(request);
+        }
+        request->state = REQUEST_CONNECTED;
+    } else if (state == BINC_DISCONNECTED) {
+        if (request->state == REQUEST_CONNECTING) {
+            binc_internal_handle_failure(manager, request, error);
+        } else if (request->state == REQUEST_CONNECTED) {
+            log_debug(TAG, "'%s' disconnected, queueing reconnect", request->path);
+            request->state = REQUEST_QUEUED;
+        }
+    } else {
+        return;
+    }
+
+    binc_internal_schedule_dispatch(manager);
+}
+
+void binc_connection_manager_device_removed(ConnectionManager *manager, Device *device) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+
+    ConnectionRequest *request = g_hash_table_lookup(manager->requests, binc_device_get_path(device));
+    if (request == NULL) return;
+
+    // Free the connecting slot and reconnect once the device is rediscovered
+    if (request->state == REQUEST_CONNECTING || request->state == REQUEST_CONNECTED) {
+        log_debug(TAG, "'%s' removed, waiting for it to be rediscovered", request->path);
+        request->state = REQUEST_QUEUED;
+        binc_internal_schedule_dispatch(manager);
+    }
+}
+
+void binc_connection_manager_device_added(ConnectionManager *manager, Device *device) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+
+    if (g_hash_table_contains(manager->requests, binc_device_get_path(device))) {
+        binc_internal_dispatch(manager);
+    }
+}
+
+void binc_connection_manager_enqueue(ConnectionManager *manager, Device *device, guint8 priority_class) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+
+    const char *path = binc_device_get_path(device);
+    ConnectionRequest *request = g_hash_table_lookup(manager->requests, path);
+    if (request == NULL) {
+        request = g_new0(ConnectionRequest, 1);
+        request->manager = manager;
+        request->path = g_strdup(path);
+        request->state = REQUEST_QUEUED;
+        g_hash_table_insert(manager->requests, (gpointer) request->path, request);
+    } else if (request->state == REQUEST_FAILED) {
+        request->consecutive_failures = 0;
+        request->state = REQUEST_QUEUED;
+    }
+    request->priority_class = priority_class;
+
+    binc_internal_dispatch(manager);
+}
+
+void binc_connection_manager_remove(ConnectionManager *manager, Device *device) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+
+    g_hash_table_remove(manager->requests, binc_device_get_path(device));
+}
+
+void binc_connection_manager_set_max_connecting(ConnectionManager *manager, guint max_connecting) {
+    g_assert(manager != NULL);
+    g_assert(max_connecting > 0);
+
+    manager->max_connecting = max_connecting;
+    binc_internal_dispatch(manager);
+}
+
+void binc_connection_manager_set_backoff(ConnectionManager *manager,
+                                         guint initial_delay_ms,
+                                         guint max_delay_ms,
+                                         guint max_attempts) {
+    g_assert(manager != NULL);
+    g_assert(initial_delay_ms > 0);
+    g_assert(max_delay_ms >= initial_delay_ms);
+
+    manager->initial_delay_ms = initial_delay_ms;
+    manager->max_delay_ms = max_delay_ms;
+    manager->max_attempts = max_attempts;
+}
+
+gboolean binc_connection_manager_get_stats(const ConnectionManager *manager, const Device *device,
+                                           ConnectionStats *stats) {
+    g_assert(manager != NULL);
+    g_assert(device != NULL);
+    g_assert(stats != NULL);
+
+    ConnectionRequest *request = g_hash_table_lookup(manager->requests, binc_device_get_path(device));
+    if (request == NULL) return FALSE;
+
+    *stats = request->stats;
+    return TRUE;
+}
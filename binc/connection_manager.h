@@ -0,0 +1,100 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_CONNECTION_MANAGER_H
+#define BINC_CONNECTION_MANAGER_H
+
+#include <gio/gio.h>
+#include "forward_decl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Connect statistics for a single device. Latencies are in microseconds and measured from
+ * issuing Connect until the device reports Connected.
+ */
+typedef struct binc_connection_stats {
+    guint attempts;
+    guint successes;
+    guint failures;
+    gint64 last_latency_us;
+    gint64 min_latency_us;
+    gint64 max_latency_us;
+    gint64 mean_latency_us;
+} ConnectionStats;
+
+/**
+ * Queue a device for connection. The connection manager connects queued devices as soon as a
+ * connection slot is available, highest priority class first and then strongest RSSI first.
+ * Failed attempts are retried with jittered exponential backoff and the device is reconnected
+ * when the connection drops. Queueing a device that is already queued only updates its priority class.
+ *
+ * @param manager the connection manager of the adapter
+ * @param device the device to connect
+ * @param priority_class higher classes are connected first
+ */
+void binc_connection_manager_enqueue(ConnectionManager *manager, Device *device, guint8 priority_class);
+
+/**
+ * Remove a device from the connection manager. Pending retries are cancelled but the device
+ * is not disconnected. Call this before binc_device_disconnect to prevent a reconnect.
+ */
+void binc_connection_manager_remove(ConnectionManager *manager, Device *device);
+
+/**
+ * Set the maximum number of devices that may be in the CONNECTING state at the same time (default 2)
+ */
+void binc_connection_manager_set_max_connecting(ConnectionManager *manager, guint max_connecting);
+
+/**
+ * Set the retry policy for failed connection attempts
+ *
+ * @param manager the connection manager
+ * @param initial_delay_ms delay before the first retry, doubled after every consecutive failure
+ * @param max_delay_ms upper bound of the delay
+ * @param max_attempts give up after this many consecutive failures, 0 means never give up
+ */
+void binc_connection_manager_set_backoff(ConnectionManager *manager,
+                                         guint initial_delay_ms,
+                                         guint max_delay_ms,
+                                         guint max_attempts);
+
+/**
+ * Get the connect statistics of a device
+ *
+ * @return TRUE if the device is known to the connection manager and stats was filled
+ */
+gboolean binc_connection_manager_get_stats(const ConnectionManager *manager, const Device *device,
+                                           ConnectionStats *stats);
+
+guint binc_connection_manager_get_connecting_count(const ConnectionManager *manager);
+
+guint binc_connection_manager_get_queued_count(const ConnectionManager *manager);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_CONNECTION_MANAGER_H
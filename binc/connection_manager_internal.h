@@ -0,0 +1,49 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_CONNECTION_MANAGER_INTERNAL_H
+#define BINC_CONNECTION_MANAGER_INTERNAL_H
+
+#include "connection_manager.h"
+#include "device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ConnectionManager *binc_connection_manager_create(Adapter *adapter);
+
+void binc_connection_manager_free(ConnectionManager *manager);
+
+void binc_connection_manager_device_state_changed(ConnectionManager *manager, Device *device,
+                                                  ConnectionState state, const GError *error);
+
+void binc_connection_manager_device_added(ConnectionManager *manager, Device *device);
+
+void binc_connection_manager_device_removed(ConnectionManager *manager, Device *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_CONNECTION_MANAGER_INTERNAL_H
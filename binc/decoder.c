@@ -0,0 +1,269 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "decoder.h"
+#include "logger.h"
+#include <string.h>
+
+static const char *const TAG = "Decoder";
+
+static const char *const BLUETOOTH_BASE_UUID_SUFFIX = "-0000-1000-8000-00805f9b34fb";
+
+// Heart Rate Measurement flags
+#define HRM_FLAG_UINT16_VALUE 0x01
+#define HRM_FLAG_CONTACT_DETECTED 0x02
+#define HRM_FLAG_CONTACT_SUPPORTED 0x04
+#define HRM_FLAG_ENERGY_EXPENDED 0x08
+#define HRM_FLAG_RR_INTERVALS 0x10
+
+// Temperature Measurement flags
+#define TEMPERATURE_FLAG_FAHRENHEIT 0x01
+#define TEMPERATURE_FLAG_TIMESTAMP 0x02
+#define TEMPERATURE_FLAG_TYPE 0x04
+
+// Blood Pressure Measurement flags
+#define BPM_FLAG_KPA 0x01
+#define BPM_FLAG_TIMESTAMP 0x02
+#define BPM_FLAG_PULSE_RATE 0x04
+#define BPM_FLAG_USER_ID 0x08
+#define BPM_FLAG_MEASUREMENT_STATUS 0x10
+
+// Weight Measurement flags
+#define WEIGHT_FLAG_IMPERIAL 0x01
+#define WEIGHT_FLAG_TIMESTAMP 0x02
+#define WEIGHT_FLAG_USER_ID 0x04
+#define WEIGHT_FLAG_BMI_AND_HEIGHT 0x08
+
+// CSC Measurement flags
+#define CSC_FLAG_WHEEL_REVOLUTIONS 0x01
+#define CSC_FLAG_CRANK_REVOLUTIONS 0x02
+
+// RSC Measurement flags
+#define RSC_FLAG_STRIDE_LENGTH 0x01
+#define RSC_FLAG_TOTAL_DISTANCE 0x02
+#define RSC_FLAG_RUNNING 0x04
+
+static GHashTable *custom_decoders = NULL;
+
+static gboolean decode_heart_rate_measurement(const GByteArray *bytes, void *result) {
+    HeartRateMeasurement *measurement = (HeartRateMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->heart_rate = (flags & HRM_FLAG_UINT16_VALUE) ? parser_get_uint16(&parser) : parser_get_uint8(&parser);
+    measurement->sensor_contact_supported = (flags & HRM_FLAG_CONTACT_SUPPORTED) != 0;
+    measurement->sensor_contact_detected = (flags & HRM_FLAG_CONTACT_DETECTED) != 0;
+    measurement->has_energy_expended = (flags & HRM_FLAG_ENERGY_EXPENDED) != 0;
+    if (measurement->has_energy_expended) {
+        measurement->energy_expended = parser_get_uint16(&parser);
+    }
+
+    if (flags & HRM_FLAG_RR_INTERVALS) {
+        guint count = MIN(parser_get_remaining(&parser) / 2, BINC_HRM_MAX_RR_INTERVALS);
+        for (guint i = 0; i < count; i++) {
+            measurement->rr_intervals[i] = parser_get_uint16(&parser);
+        }
+        measurement->rr_interval_count = count;
+    }
+    return !parser_has_error(&parser);
+}
+
+static gboolean decode_temperature_measurement(const GByteArray *bytes, void *result) {
+    TemperatureMeasurement *measurement = (TemperatureMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->temperature = parser_get_float(&parser);
+    measurement->fahrenheit = (flags & TEMPERATURE_FLAG_FAHRENHEIT) != 0;
+    measurement->has_timestamp = (flags & TEMPERATURE_FLAG_TIMESTAMP) != 0;
+    if (measurement->has_timestamp) {
+        measurement->timestamp = parser_get_plain_date_time(&parser);
+    }
+    measurement->has_temperature_type = (flags & TEMPERATURE_FLAG_TYPE) != 0;
+    if (measurement->has_temperature_type) {
+        measurement->temperature_type = parser_get_uint8(&parser);
+    }
+    return !parser_has_error(&parser);
+}
+
+static gboolean decode_blood_pressure_measurement(const GByteArray *bytes, void *result) {
+    BloodPressureMeasurement *measurement = (BloodPressureMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->systolic = parser_get_sfloat(&parser);
+    measurement->diastolic = parser_get_sfloat(&parser);
+    measurement->mean_arterial_pressure = parser_get_sfloat(&parser);
+    measurement->kpa = (flags & BPM_FLAG_KPA) != 0;
+    measurement->has_timestamp = (flags & BPM_FLAG_TIMESTAMP) != 0;
+    if (measurement->has_timestamp) {
+        measurement->timestamp = parser_get_plain_date_time(&parser);
+    }
+    measurement->has_pulse_rate = (flags & BPM_FLAG_PULSE_RATE) != 0;
+    if (measurement->has_pulse_rate) {
+        measurement->pulse_rate = parser_get_sfloat(&parser);
+    }
+    measurement->has_user_id = (flags & BPM_FLAG_USER_ID) != 0;
+    if (measurement->has_user_id) {
+        measurement->user_id = parser_get_uint8(&parser);
+    }
+    measurement->has_measurement_status = (flags & BPM_FLAG_MEASUREMENT_STATUS) != 0;
+    if (measurement->has_measurement_status) {
+        measurement->measurement_status = parser_get_uint16(&parser);
+    }
+    return !parser_has_error(&parser);
+}
+
+static gboolean decode_weight_measurement(const GByteArray *bytes, void *result) {
+    WeightMeasurement *measurement = (WeightMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->imperial = (flags & WEIGHT_FLAG_IMPERIAL) != 0;
+    double weight_resolution = measurement->imperial ? 0.01 : 0.005;
+    measurement->weight = parser_get_uint16(&parser) * weight_resolution;
+    measurement->has_timestamp = (flags & WEIGHT_FLAG_TIMESTAMP) != 0;
+    if (measurement->has_timestamp) {
+        measurement->timestamp = parser_get_plain_date_time(&parser);
+    }
+    measurement->has_user_id = (flags & WEIGHT_FLAG_USER_ID) != 0;
+    if (measurement->has_user_id) {
+        measurement->user_id = parser_get_uint8(&parser);
+    }
+    measurement->has_bmi_and_height = (flags & WEIGHT_FLAG_BMI_AND_HEIGHT) != 0;
+    if (measurement->has_bmi_and_height) {
+        double height_resolution = measurement->imperial ? 0.1 : 0.001;
+        measurement->bmi = parser_get_uint16(&parser) * 0.1;
+        measurement->height = parser_get_uint16(&parser) * height_resolution;
+    }
+    return !parser_has_error(&parser);
+}
+
+static gboolean decode_csc_measurement(const GByteArray *bytes, void *result) {
+    CscMeasurement *measurement = (CscMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->has_wheel_revolutions = (flags & CSC_FLAG_WHEEL_REVOLUTIONS) != 0;
+    if (measurement->has_wheel_revolutions) {
+        measurement->cumulative_wheel_revolutions = parser_get_uint32(&parser);
+        measurement->last_wheel_event_time = parser_get_uint16(&parser);
+    }
+    measurement->has_crank_revolutions = (flags & CSC_FLAG_CRANK_REVOLUTIONS) != 0;
+    if (measurement->has_crank_revolutions) {
+        measurement->cumulative_crank_revolutions = parser_get_uint16(&parser);
+        measurement->last_crank_event_time = parser_get_uint16(&parser);
+    }
+    return !parser_has_error(&parser);
+}
+
+static gboolean decode_rsc_measurement(const GByteArray *bytes, void *result) {
+    RscMeasurement *measurement = (RscMeasurement *) result;
+    Parser parser;
+    parser_init(&parser, bytes->data, bytes->len, LITTLE_ENDIAN);
+
+    guint8 flags = parser_get_uint8(&parser);
+    measurement->speed = parser_get_uint16(&parser) / 256.0;
+    measurement->cadence = parser_get_uint8(&parser);
+    measurement->running = (flags & RSC_FLAG_RUNNING) != 0;
+    measurement->has_stride_length = (flags & RSC_FLAG_STRIDE_LENGTH) != 0;
+    if (measurement->has_stride_length) {
+        measurement->stride_length = parser_get_uint16(&parser) / 100.0;
+    }
+    measurement->has_total_distance = (flags & RSC_FLAG_TOTAL_DISTANCE) != 0;
+    if (measurement->has_total_distance) {
+        measurement->total_distance = parser_get_uint32(&parser) / 10.0;
+    }
+    return !parser_has_error(&parser);
+}
+
+static const Decoder standard_decoders[] = {
+        {0x2A37, "Heart Rate Measurement",     sizeof(HeartRateMeasurement),     decode_heart_rate_measurement},
+        {0x2A1C, "Temperature Measurement",    sizeof(TemperatureMeasurement),   decode_temperature_measurement},
+        {0x2A1E, "Intermediate Temperature",   sizeof(TemperatureMeasurement),   decode_temperature_measurement},
+        {0x2A35, "Blood Pressure Measurement", sizeof(BloodPressureMeasurement), decode_blood_pressure_measurement},
+        {0x2A36, "Intermediate Cuff Pressure", sizeof(BloodPressureMeasurement), decode_blood_pressure_measurement},
+        {0x2A9D, "Weight Measurement",         sizeof(WeightMeasurement),        decode_weight_measurement},
+        {0x2A5B, "CSC Measurement",            sizeof(CscMeasurement),           decode_csc_measurement},
+        {0x2A53, "RSC Measurement",            sizeof(RscMeasurement),           decode_rsc_measurement},
+};
+
+const Decoder *binc_decoder_lookup(guint16 uuid16) {
+    if (custom_decoders != NULL) {
+        const Decoder *decoder = g_hash_table_lookup(custom_decoders, GUINT_TO_POINTER(uuid16));
+        if (decoder != NULL) return decoder;
+    }
+
+    for (guint i = 0; i < G_N_ELEMENTS(standard_decoders); i++) {
+        if (standard_decoders[i].uuid16 == uuid16) {
+            return &standard_decoders[i];
+        }
+    }
+    return NULL;
+}
+
+const Decoder *binc_decoder_lookup_by_uuid(const char *uuid) {
+    g_assert(uuid != NULL);
+
+    // Only UUIDs of the form 0000xxxx-0000-1000-8000-00805f9b34fb have a 16-bit alias
+    if (strlen(uuid) != 36 || strncmp(uuid, "0000", 4) != 0) return NULL;
+    if (g_ascii_strcasecmp(uuid + 8, BLUETOOTH_BASE_UUID_SUFFIX) != 0) return NULL;
+
+    guint16 uuid16 = 0;
+    for (guint i = 4; i < 8; i++) {
+        gint digit = g_ascii_xdigit_value(uuid[i]);
+        if (digit < 0) return NULL;
+        uuid16 = (guint16) ((uuid16 << 4) | (guint16) digit);
+    }
+    return binc_decoder_lookup(uuid16);
+}
+
+void binc_decoder_register(const Decoder *decoder) {
+    g_assert(decoder != NULL);
+    g_assert(decoder->decode != NULL);
+    g_assert(decoder->result_size <= sizeof(DecodedValue));
+
+    if (custom_decoders == NULL) {
+        custom_decoders = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+    g_hash_table_insert(custom_decoders, GUINT_TO_POINTER(decoder->uuid16), (gpointer) decoder);
+}
+
+gboolean binc_decoder_decode(const Decoder *decoder, const GByteArray *bytes, DecodedValue *result) {
+    g_assert(decoder != NULL);
+    g_assert(result != NULL);
+
+    if (bytes == NULL) return FALSE;
+
+    memset(result, 0, decoder->result_size);
+    if (!decoder->decode(bytes, result)) {
+        log_debug(TAG, "malformed %s (%u bytes)", decoder->name, bytes->len);
+        return FALSE;
+    }
+    return TRUE;
+}
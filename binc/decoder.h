@@ -0,0 +1,176 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_DECODER_H
+#define BINC_DECODER_H
+
+#include <glib.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BINC_HRM_MAX_RR_INTERVALS 16
+#define BINC_DECODED_VALUE_MAX_SIZE 128
+
+/**
+ * Heart Rate Measurement (0x2A37)
+ */
+typedef struct binc_heart_rate_measurement {
+    guint16 heart_rate; // Beats per minute
+    gboolean sensor_contact_supported;
+    gboolean sensor_contact_detected;
+    gboolean has_energy_expended;
+    guint16 energy_expended; // Kilo Joules
+    guint rr_interval_count;
+    guint16 rr_intervals[BINC_HRM_MAX_RR_INTERVALS]; // 1/1024 seconds
+} HeartRateMeasurement;
+
+/**
+ * Temperature Measurement (0x2A1C) and Intermediate Temperature (0x2A1E)
+ */
+typedef struct binc_temperature_measurement {
+    double temperature;
+    gboolean fahrenheit;
+    gboolean has_timestamp;
+    ParserDateTime timestamp;
+    gboolean has_temperature_type;
+    guint8 temperature_type;
+} TemperatureMeasurement;
+
+/**
+ * Blood Pressure Measurement (0x2A35) and Intermediate Cuff Pressure (0x2A36)
+ */
+typedef struct binc_blood_pressure_measurement {
+    double systolic;
+    double diastolic;
+    double mean_arterial_pressure;
+    gboolean kpa; // mmHg otherwise
+    gboolean has_timestamp;
+    ParserDateTime timestamp;
+    gboolean has_pulse_rate;
+    double pulse_rate;
+    gboolean has_user_id;
+    guint8 user_id;
+    gboolean has_measurement_status;
+    guint16 measurement_status;
+} BloodPressureMeasurement;
+
+/**
+ * Weight Measurement (0x2A9D)
+ */
+typedef struct binc_weight_measurement {
+    double weight; // Kilograms or pounds
+    gboolean imperial;
+    gboolean has_timestamp;
+    ParserDateTime timestamp;
+    gboolean has_user_id;
+    guint8 user_id;
+    gboolean has_bmi_and_height;
+    double bmi;
+    double height; // Meters or inches
+} WeightMeasurement;
+
+/**
+ * CSC Measurement (0x2A5B)
+ */
+typedef struct binc_csc_measurement {
+    gboolean has_wheel_revolutions;
+    guint32 cumulative_wheel_revolutions;
+    guint16 last_wheel_event_time; // 1/1024 seconds
+    gboolean has_crank_revolutions;
+    guint16 cumulative_crank_revolutions;
+    guint16 last_crank_event_time; // 1/1024 seconds
+} CscMeasurement;
+
+/**
+ * RSC Measurement (0x2A53)
+ */
+typedef struct binc_rsc_measurement {
+    double speed; // Meters per second
+    guint8 cadence; // Steps per minute
+    gboolean running; // Walking otherwise
+    gboolean has_stride_length;
+    double stride_length; // Meters
+    gboolean has_total_distance;
+    double total_distance; // Meters
+} RscMeasurement;
+
+/**
+ * Storage for a decoded value, big enough for all standard decoders and for custom decoders
+ * with a result_size up to BINC_DECODED_VALUE_MAX_SIZE
+ */
+typedef union binc_decoded_value {
+    HeartRateMeasurement heart_rate;
+    TemperatureMeasurement temperature;
+    BloodPressureMeasurement blood_pressure;
+    WeightMeasurement weight;
+    CscMeasurement csc;
+    RscMeasurement rsc;
+    guint8 custom[BINC_DECODED_VALUE_MAX_SIZE];
+} DecodedValue;
+
+/**
+ * Decode bytes into result, returns FALSE if the bytes are malformed
+ */
+typedef gboolean (*DecodeFunc)(const GByteArray *bytes, void *result);
+
+typedef struct binc_decoder {
+    guint16 uuid16;
+    const char *name;
+    gsize result_size;
+    DecodeFunc decode;
+} Decoder;
+
+/**
+ * Look up the decoder for a 16-bit characteristic UUID
+ *
+ * @return the decoder or NULL if there is none
+ */
+const Decoder *binc_decoder_lookup(guint16 uuid16);
+
+/**
+ * Look up the decoder for a full characteristic UUID based on the Bluetooth base UUID
+ *
+ * @return the decoder or NULL if the UUID is not a 16-bit UUID or there is no decoder for it
+ */
+const Decoder *binc_decoder_lookup_by_uuid(const char *uuid);
+
+/**
+ * Register a decoder, replacing any decoder for the same UUID. The decoder is borrowed and must stay valid.
+ */
+void binc_decoder_register(const Decoder *decoder);
+
+/**
+ * Decode bytes with a decoder into result
+ *
+ * @return TRUE if decoding succeeded
+ */
+gboolean binc_decoder_decode(const Decoder *decoder, const GByteArray *bytes, DecodedValue *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_DECODER_H
@@ -43,9 +43,10 @@ struct binc_descriptor {
     Device *device; // Borrowed
     Characteristic *characteristic; // Borrowed
     GDBusConnection *connection; // Borrowed
-    const char *path; // Owned
-    const char *char_path; // Owned
-    const char *uuid; // Owned
+    Arena *arena; // Owned reference
+    const char *path; // Owned by GATT arena
+    const char *char_path; // Owned by GATT arena
+    const char *uuid; // Owned by GATT arena
     GList *flags; // Owned
 
     OnDescReadCallback on_read_cb;
@@ -57,10 +58,12 @@ Descriptor *binc_descriptor_create(Device *device, const char *path) {
     g_assert(path != NULL);
     g_assert(strlen(path) > 0);
 
-    Descriptor *descriptor = g_new0(Descriptor, 1);
+    Arena *arena = binc_device_get_gatt_arena(device);
+    Descriptor *descriptor = binc_arena_new0(arena, Descriptor);
     descriptor->device = device;
     descriptor->connection = binc_device_get_dbus_connection(device);
-    descriptor->path = g_strdup(path);
+    descriptor->arena = binc_arena_ref(arena);
+    descriptor->path = binc_arena_strdup(arena, path);
     return descriptor;
 }
 
@@ -72,17 +75,17 @@ void binc_descriptor_free(Descriptor *descriptor) {
         descriptor->flags = NULL;
     }
 
-    g_free((char *) descriptor->uuid);
     descriptor->uuid = NULL;
-    g_free((char *) descriptor->path);
     descriptor->path = NULL;
-    g_free((char *) descriptor->char_path);
     descriptor->char_path = NULL;
-
     descriptor->characteristic = NULL;
     descriptor->device = NULL;
     descriptor->connection = NULL;
-    g_free(descriptor);
+
+    // The struct and its strings live in the arena, so this must be the last thing we do
+    Arena *arena = descriptor->arena;
+    descriptor->arena = NULL;
+    binc_arena_unref(arena);
 }
 
 const char *binc_descriptor_to_string(const Descriptor *descriptor) {
@@ -112,16 +115,24 @@ void binc_descriptor_set_uuid(Descriptor *descriptor, const char *uuid) {
     g_assert(descriptor != NULL);
     g_assert(is_valid_uuid(uuid));
 
-    g_free((char *) descriptor->uuid);
-    descriptor->uuid = g_strdup(uuid);
+    // Strings can't be freed individually so only copy when the value changes
+    if (descriptor->uuid == NULL || !g_str_equal(descriptor->uuid, uuid)) {
+        descriptor->uuid = binc_arena_strdup(descriptor->arena, uuid);
+    }
 }
 
 void binc_descriptor_set_char_path(Descriptor *descriptor, const char *path) {
     g_assert(descriptor != NULL);
     g_assert(path != NULL);
 
-    g_free((char *) descriptor->char_path);
-    descriptor->char_path = g_strdup(path);
+    if (descriptor->char_path == NULL || !g_str_equal(descriptor->char_path, path)) {
+        descriptor->char_path = binc_arena_strdup(descriptor->arena, path);
+    }
+}
+
+const char *binc_descriptor_get_path(const Descriptor *descriptor) {
+    g_assert(descriptor != NULL);
+    return descriptor->path;
 }
 
 const char *binc_descriptor_get_char_path(const Descriptor *descriptor) {
@@ -28,9 +28,12 @@
 #include "service_internal.h"
 #include "characteristic_internal.h"
 #include "adapter.h"
+#include "adapter_internal.h"
 #include "descriptor_internal.h"
+#include "connection_manager_internal.h"
 
 static const char *const TAG = "Device";
+static const gsize GATT_ARENA_CHUNK_SIZE = 4096;
 static const char *const BLUEZ_DBUS = "org.bluez";
 static const char *const INTERFACE_DEVICE = "org.bluez.Device1";
 
@@ -87,16 +90,19 @@ struct binc_device {
     guint device_prop_changed;
     ConnectionStateChangedCallback connection_state_callback;
     ServicesResolvedCallback services_resolved_callback;
+    GattTreeChangedCallback gatt_tree_changed_callback;
     BondingStateChangedCallback bonding_state_callback;
     GHashTable *services; // Owned
     GList *services_list; // Owned
     GHashTable *characteristics; // Owned
     GHashTable *descriptors; // Owned
+    Arena *gatt_arena; // Owned
     gboolean is_central;
 
     OnReadCallback on_read_callback;
     OnWriteCallback on_write_callback;
     OnNotifyCallback on_notify_callback;
+    OnNotifyExtCallback on_notify_ext_callback;
     OnNotifyingStateChangedCallback on_notify_state_callback;
     OnDescReadCallback on_read_desc_cb;
     OnDescWriteCallback on_write_desc_cb;
@@ -110,7 +116,7 @@ Device *binc_device_create(const char *path, Adapter *adapter) {
     g_assert(adapter != NULL);
     g_assert(g_str_has_prefix(path, binc_adapter_get_path(adapter)));
 
-    Device *device = g_new0(Device, 1);
+    Device *device = binc_slab_alloc0(binc_adapter_get_device_slab(adapter));
     device->path = g_strdup(path);
     device->adapter = adapter;
     device->connection = binc_adapter_get_dbus_connection(adapter);
@@ -150,6 +156,36 @@ static void binc_device_free_service_data(Device *device) {
     }
 }
 
+static void binc_device_free_gatt_tree(Device *device) {
+    g_assert(device != NULL);
+
+    if (device->descriptors != NULL) {
+        g_hash_table_destroy(device->descriptors);
+        device->descriptors = NULL;
+    }
+
+    if (device->characteristics != NULL) {
+        g_hash_table_destroy(device->characteristics);
+        device->characteristics = NULL;
+    }
+
+    if (device->services != NULL) {
+        g_hash_table_destroy(device->services);
+        device->services = NULL;
+    }
+
+    if (device->services_list != NULL) {
+        g_list_free(device->services_list);
+        device->services_list = NULL;
+    }
+
+    // Objects hold their own reference to the arena, this drops the device's reference
+    if (device->gatt_arena != NULL) {
+        binc_arena_unref(device->gatt_arena);
+        device->gatt_arena = NULL;
+    }
+}
+
 void binc_device_free(Device *device) {
     g_assert(device != NULL);
 
@@ -171,33 +207,15 @@ void binc_device_free(Device *device) {
     g_free((char *) device->name);
     device->name = NULL;
 
-    if (device->descriptors != NULL) {
-        g_hash_table_destroy(device->descriptors);
-        device->descriptors = NULL;
-    }
-
-    if (device->characteristics != NULL) {
-        g_hash_table_destroy(device->characteristics);
-        device->characteristics = NULL;
-    }
-
-    if (device->services != NULL) {
-        g_hash_table_destroy(device->services);
-        device->services = NULL;
-    }
-
+    binc_device_free_gatt_tree(device);
     binc_device_free_manufacturer_data(device);
     binc_device_free_service_data(device);
     binc_device_free_uuids(device);
 
-    if (device->services_list != NULL) {
-        g_list_free(device->services_list);
-        device->services_list = NULL;
-    }
-
+    Slab *slab = binc_adapter_get_device_slab(device->adapter);
     device->connection = NULL;
     device->adapter = NULL;
-    g_free(device);
+    binc_slab_release(slab, device);
 }
 
 char *binc_device_to_string(const Device *device) {
@@ -281,8 +299,11 @@ binc_on_characteristic_write(Device *device, Characteristic *characteristic, con
     }
 }
 
-static void binc_on_characteristic_notify(Device *device, Characteristic *characteristic, const GByteArray *byteArray) {
-    if (device->on_notify_callback != NULL) {
+static void binc_on_characteristic_notify(Device *device, Characteristic *characteristic, const GByteArray *byteArray,
+                                          const NotificationInfo *info) {
+    if (device->on_notify_ext_callback != NULL) {
+        device->on_notify_ext_callback(device, characteristic, byteArray, info);
+    } else if (device->on_notify_callback != NULL) {
         device->on_notify_callback(device, characteristic, byteArray);
     }
 }
@@ -308,6 +329,10 @@ static void binc_on_descriptor_write(Device *device, Descriptor *descriptor, con
 static void binc_device_internal_set_conn_state(Device *device, ConnectionState state, GError *error) {
     ConnectionState old_state = device->connection_state;
     device->connection_state = state;
+    if (device->connection_state != old_state) {
+        binc_connection_manager_device_state_changed(binc_adapter_get_connection_manager(device->adapter),
+                                                     device, state, error);
+    }
     if (device->connection_state_callback != NULL) {
         if (device->connection_state != old_state) {
             device->connection_state_callback(device, state, error);
@@ -315,39 +340,69 @@ static void binc_device_internal_set_conn_state(Device *device, ConnectionState
     }
 }
 
-static void binc_internal_extract_service(Device *device, const char *object_path, GVariant *properties) {
+typedef struct binc_gatt_tree_update {
+    GHashTable *old_services; // Owned
+    GHashTable *old_characteristics; // Owned
+    GHashTable *old_descriptors; // Owned
+    GattTreeChanges changes;
+} GattTreeUpdate;
+
+static const char *binc_internal_lookup_uuid(GVariant *properties) {
+    const char *uuid = NULL;
+    g_variant_lookup(properties, "UUID", "&s", &uuid);
+    return uuid;
+}
+
+static void binc_internal_extract_service(Device *device, GattTreeUpdate *update, const char *object_path,
+                                          GVariant *properties) {
     g_assert(device != NULL);
     g_assert(object_path != NULL);
     g_assert(properties != NULL);
 
-    char *uuid = NULL;
-    const char *property_name;
-    GVariantIter iter;
-    GVariant *property_value;
-
-    g_variant_iter_init(&iter, properties);
-    while (g_variant_iter_loop(&iter, "{&sv}", &property_name, &property_value)) {
-        if (g_str_equal(property_name, "UUID")) {
-            uuid = g_strdup(g_variant_get_string(property_value, NULL));
-        }
+    const char *uuid = binc_internal_lookup_uuid(properties);
+    if (uuid == NULL) {
+        log_error(TAG, "service %s has no UUID", object_path);
+        return;
     }
 
-    Service *service = binc_service_create(device, object_path, uuid);
-    g_hash_table_insert(device->services, g_strdup(object_path), service);
-    g_free(uuid);
+    // Keep the existing service if nothing changed
+    Service *service = g_hash_table_lookup(update->old_services, object_path);
+    if (service != NULL && g_str_equal(binc_service_get_uuid(service), uuid)) {
+        g_hash_table_steal(update->old_services, object_path);
+        update->changes.services_kept++;
+    } else {
+        service = binc_service_create(device, object_path, uuid);
+        update->changes.added_services = g_list_prepend(update->changes.added_services, service);
+    }
+    g_hash_table_insert(device->services, (gpointer) binc_service_get_path(service), service);
 }
 
-static void binc_internal_extract_characteristic(Device *device, const char *object_path, GVariant *properties) {
+static void binc_internal_extract_characteristic(Device *device, GattTreeUpdate *update, const char *object_path,
+                                                 GVariant *properties) {
     g_assert(device != NULL);
     g_assert(object_path != NULL);
     g_assert(properties != NULL);
 
-    Characteristic *characteristic = binc_characteristic_create(device, object_path);
-    binc_characteristic_set_read_cb(characteristic, &binc_on_characteristic_read);
-    binc_characteristic_set_write_cb(characteristic, &binc_on_characteristic_write);
-    binc_characteristic_set_notify_cb(characteristic, &binc_on_characteristic_notify);
-    binc_characteristic_set_notifying_state_change_cb(characteristic,
-                                                      &binc_on_characteristic_notification_state_changed);
+    const char *uuid = binc_internal_lookup_uuid(properties);
+    if (uuid == NULL) {
+        log_error(TAG, "characteristic %s has no UUID", object_path);
+        return;
+    }
+
+    // Keep the existing characteristic, including its handlers and subscription, if the UUID didn't change
+    gboolean is_new = FALSE;
+    Characteristic *characteristic = g_hash_table_lookup(update->old_characteristics, object_path);
+    if (characteristic != NULL && g_str_equal(binc_characteristic_get_uuid(characteristic), uuid)) {
+        g_hash_table_steal(update->old_characteristics, object_path);
+    } else {
+        is_new = TRUE;
+        characteristic = binc_characteristic_create(device, object_path);
+        binc_characteristic_set_read_cb(characteristic, &binc_on_characteristic_read);
+        binc_characteristic_set_write_cb(characteristic, &binc_on_characteristic_write);
+        binc_characteristic_set_notify_cb(characteristic, &binc_on_characteristic_notify);
+        binc_characteristic_set_notifying_state_change_cb(characteristic,
+                                                          &binc_on_characteristic_notification_state_changed);
+    }
 
     const char *property_name;
     GVariantIter iter;
@@ -376,28 +431,62 @@ static void binc_internal_extract_characteristic(Device *device, const char *obj
     // Get service and link the characteristic to the service
     Service *service = g_hash_table_lookup(device->services,
                                            binc_characteristic_get_service_path(characteristic));
-    if (service != NULL) {
+    if (service == NULL) {
+        log_error(TAG, "could not find service %s",
+                  binc_characteristic_get_service_path(characteristic));
+        if (is_new) {
+            binc_characteristic_free(characteristic);
+        } else {
+            // Report it as removed
+            g_hash_table_insert(update->old_characteristics,
+                                (gpointer) binc_characteristic_get_path(characteristic),
+                                characteristic);
+        }
+        return;
+    }
+
+    // The service may have been replaced, in that case move the characteristic over
+    if (binc_characteristic_get_service(characteristic) != service) {
         binc_service_add_characteristic(service, characteristic);
         binc_characteristic_set_service(characteristic, service);
-        g_hash_table_insert(device->characteristics, g_strdup(object_path), characteristic);
+    }
+    g_hash_table_insert(device->characteristics,
+                        (gpointer) binc_characteristic_get_path(characteristic),
+                        characteristic);
 
+    if (is_new) {
+        update->changes.added_characteristics = g_list_prepend(update->changes.added_characteristics,
+                                                               characteristic);
         char *charString = binc_characteristic_to_string(characteristic);
         log_debug(TAG, charString);
         g_free(charString);
     } else {
-        log_error(TAG, "could not find service %s",
-                  binc_characteristic_get_service_path(characteristic));
+        update->changes.characteristics_kept++;
     }
 }
 
-static void binc_internal_extract_descriptor(Device *device, const char *object_path, GVariant *properties) {
+static void binc_internal_extract_descriptor(Device *device, GattTreeUpdate *update, const char *object_path,
+                                             GVariant *properties) {
     g_assert(device != NULL);
     g_assert(object_path != NULL);
     g_assert(properties != NULL);
 
-    Descriptor *descriptor = binc_descriptor_create(device, object_path);
-    binc_descriptor_set_read_cb(descriptor, &binc_on_descriptor_read);
-    binc_descriptor_set_write_cb(descriptor, &binc_on_descriptor_write);
+    const char *uuid = binc_internal_lookup_uuid(properties);
+    if (uuid == NULL) {
+        log_error(TAG, "descriptor %s has no UUID", object_path);
+        return;
+    }
+
+    gboolean is_new = FALSE;
+    Descriptor *descriptor = g_hash_table_lookup(update->old_descriptors, object_path);
+    if (descriptor != NULL && g_str_equal(binc_descriptor_get_uuid(descriptor), uuid)) {
+        g_hash_table_steal(update->old_descriptors, object_path);
+    } else {
+        is_new = TRUE;
+        descriptor = binc_descriptor_create(device, object_path);
+        binc_descriptor_set_read_cb(descriptor, &binc_on_descriptor_read);
+        binc_descriptor_set_write_cb(descriptor, &binc_on_descriptor_write);
+    }
 
     const char *property_name;
     GVariantIter iter;
@@ -417,18 +506,112 @@ static void binc_internal_extract_descriptor(Device *device, const char *object_
     // Look up characteristic
     Characteristic *characteristic = g_hash_table_lookup(device->characteristics,
                                                          binc_descriptor_get_char_path(descriptor));
-    if (characteristic != NULL) {
+    if (characteristic == NULL) {
+        log_error(TAG, "could not find characteristic %s",
+                  binc_descriptor_get_char_path(descriptor));
+        if (is_new) {
+            binc_descriptor_free(descriptor);
+        } else {
+            g_hash_table_insert(update->old_descriptors,
+                                (gpointer) binc_descriptor_get_path(descriptor),
+                                descriptor);
+        }
+        return;
+    }
+
+    if (binc_descriptor_get_char(descriptor) != characteristic) {
         binc_characteristic_add_descriptor(characteristic, descriptor);
         binc_descriptor_set_char(descriptor, characteristic);
-        g_hash_table_insert(device->descriptors, g_strdup(object_path), descriptor);
+    }
+    g_hash_table_insert(device->descriptors,
+                        (gpointer) binc_descriptor_get_path(descriptor),
+                        descriptor);
 
+    if (is_new) {
+        update->changes.added_descriptors = g_list_prepend(update->changes.added_descriptors, descriptor);
         const char *descString = binc_descriptor_to_string(descriptor);
         log_debug(TAG, descString);
         g_free((char *) descString);
     } else {
-        log_error(TAG, "could not find characteristic %s",
-                  binc_descriptor_get_char_path(descriptor));
+        update->changes.descriptors_kept++;
+    }
+}
+
+static void binc_internal_begin_gatt_tree_update(Device *device, GattTreeUpdate *update) {
+    memset(update, 0, sizeof(GattTreeUpdate));
+
+    // Hash table keys are the object paths stored in the objects themselves
+    update->old_services = device->services != NULL ? device->services :
+                           g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) binc_service_free);
+    update->old_characteristics = device->characteristics != NULL ? device->characteristics :
+                                  g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                                        (GDestroyNotify) binc_characteristic_free);
+    update->old_descriptors = device->descriptors != NULL ? device->descriptors :
+                              g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                                    (GDestroyNotify) binc_descriptor_free);
+
+    device->services = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             NULL, (GDestroyNotify) binc_service_free);
+    device->characteristics = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                    NULL, (GDestroyNotify) binc_characteristic_free);
+    device->descriptors = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                NULL, (GDestroyNotify) binc_descriptor_free);
+
+    // New objects go into a fresh arena, objects that are kept hold on to their own arena
+    if (device->gatt_arena != NULL) {
+        binc_arena_unref(device->gatt_arena);
+    }
+    device->gatt_arena = binc_arena_create(GATT_ARENA_CHUNK_SIZE);
+}
+
+static void binc_internal_finish_gatt_tree_update(Device *device, GattTreeUpdate *update) {
+    GattTreeChanges *changes = &update->changes;
+
+    // Whatever is left in the old tables is no longer part of the tree
+    changes->removed_services = g_hash_table_get_values(update->old_services);
+    changes->removed_characteristics = g_hash_table_get_values(update->old_characteristics);
+    changes->removed_descriptors = g_hash_table_get_values(update->old_descriptors);
+
+    // Unlink removed objects from parents that are kept
+    for (GList *iterator = changes->removed_descriptors; iterator; iterator = iterator->next) {
+        Descriptor *descriptor = (Descriptor *) iterator->data;
+        Characteristic *characteristic = binc_descriptor_get_char(descriptor);
+        if (characteristic != NULL) {
+            binc_characteristic_remove_descriptor(characteristic, descriptor);
+        }
+    }
+    for (GList *iterator = changes->removed_characteristics; iterator; iterator = iterator->next) {
+        Characteristic *characteristic = (Characteristic *) iterator->data;
+        Service *service = binc_characteristic_get_service(characteristic);
+        if (service != NULL) {
+            binc_service_remove_characteristic(service, characteristic);
+        }
+    }
+
+    log_debug(TAG, "gatt tree: services +%d -%d =%d, characteristics +%d -%d =%d, descriptors +%d -%d =%d",
+              g_list_length(changes->added_services), g_list_length(changes->removed_services),
+              changes->services_kept,
+              g_list_length(changes->added_characteristics), g_list_length(changes->removed_characteristics),
+              changes->characteristics_kept,
+              g_list_length(changes->added_descriptors), g_list_length(changes->removed_descriptors),
+              changes->descriptors_kept);
+
+    if (device->gatt_tree_changed_callback != NULL) {
+        device->gatt_tree_changed_callback(device, changes);
     }
+
+    // Removed objects are freed here, so only after the callback returned
+    g_hash_table_destroy(update->old_descriptors);
+    g_hash_table_destroy(update->old_characteristics);
+    g_hash_table_destroy(update->old_services);
+
+    g_list_free(changes->added_services);
+    g_list_free(changes->removed_services);
+    g_list_free(changes->added_characteristics);
+    g_list_free(changes->removed_characteristics);
+    g_list_free(changes->added_descriptors);
+    g_list_free(changes->removed_descriptors);
+    memset(update, 0, sizeof(GattTreeUpdate));
 }
 
 static void binc_internal_collect_gatt_tree_cb(__attribute__((unused)) GObject *source_object,
@@ -454,23 +637,8 @@ static void binc_internal_collect_gatt_tree_cb(__attribute__((unused)) GObject *
     const char *object_path;
     GVariant *ifaces_and_properties;
     if (result) {
-        if (device->services != NULL) {
-            g_hash_table_destroy(device->services);
-        }
-        device->services = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                 g_free, (GDestroyNotify) binc_service_free);
-
-        if (device->characteristics != NULL) {
-            g_hash_table_destroy(device->characteristics);
-        }
-        device->characteristics = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                        g_free, (GDestroyNotify) binc_characteristic_free);
-
-        if (device->descriptors != NULL) {
-            g_hash_table_destroy(device->descriptors);
-        }
-        device->descriptors = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                    g_free, (GDestroyNotify) binc_descriptor_free);
+        GattTreeUpdate update;
+        binc_internal_begin_gatt_tree_update(device, &update);
 
         g_assert(g_str_equal(g_variant_get_type_string(result), "(a{oa{sa{sv}}})"));
         g_variant_get(result, "(a{oa{sa{sv}}})", &iter);
@@ -482,17 +650,19 @@ static void binc_internal_collect_gatt_tree_cb(__attribute__((unused)) GObject *
                 g_variant_iter_init(&iter2, ifaces_and_properties);
                 while (g_variant_iter_loop(&iter2, "{&s@a{sv}}", &interface_name, &properties)) {
                     if (g_str_equal(interface_name, INTERFACE_SERVICE)) {
-                        binc_internal_extract_service(device, object_path, properties);
+                        binc_internal_extract_service(device, &update, object_path, properties);
                     } else if (g_str_equal(interface_name, INTERFACE_CHARACTERISTIC)) {
-                        binc_internal_extract_characteristic(device, object_path, properties);
+                        binc_internal_extract_characteristic(device, &update, object_path, properties);
                     } else if (g_str_equal(interface_name, INTERFACE_DESCRIPTOR)) {
-                        binc_internal_extract_descriptor(device, object_path, properties);
+                        binc_internal_extract_descriptor(device, &update, object_path, properties);
 
                     }
                 }
             }
         }
 
+        binc_internal_finish_gatt_tree_update(device, &update);
+
         if (iter != NULL) {
             g_variant_iter_free(iter);
         }
@@ -528,6 +698,13 @@ static void binc_collect_gatt_tree(Device *device) {
                            device);
 }
 
+void binc_device_set_gatt_tree_changed_cb(Device *device, GattTreeChangedCallback callback) {
+    g_assert(device != NULL);
+    g_assert(callback != NULL);
+
+    device->gatt_tree_changed_callback = callback;
+}
+
 void binc_device_set_bonding_state_changed_cb(Device *device, BondingStateChangedCallback callback) {
     g_assert(device != NULL);
     g_assert(callback != NULL);
@@ -897,6 +1074,12 @@ void binc_device_set_notify_char_cb(Device *device, OnNotifyCallback callback) {
     device->on_notify_callback = callback;
 }
 
+void binc_device_set_notify_char_ext_cb(Device *device, OnNotifyExtCallback callback) {
+    g_assert(device != NULL);
+    g_assert(callback != NULL);
+    device->on_notify_ext_callback = callback;
+}
+
 void binc_device_set_notify_state_cb(Device *device, OnNotifyingStateChangedCallback callback) {
     g_assert(device != NULL);
     g_assert(callback != NULL);
@@ -1221,3 +1404,12 @@ void *binc_device_get_user_data(const Device *device) {
     return device->user_data;
 }
 
+Arena *binc_device_get_gatt_arena(const Device *device) {
+    g_assert(device != NULL);
+    g_assert(device->gatt_arena != NULL);
+    return device->gatt_arena;
+}
+
+gsize binc_device_get_struct_size(void) {
+    return sizeof(Device);
+}
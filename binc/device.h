@@ -44,6 +44,25 @@ typedef void (*ConnectionStateChangedCallback)(Device *device, ConnectionState s
 
 typedef void (*ServicesResolvedCallback)(Device *device);
 
+/**
+ * Changes to the GATT tree of a device after services were resolved.
+ * Objects that did not change (same path and UUID) are kept, so pointers held by the application remain valid.
+ * Removed objects are only valid during the callback, all lists are owned by the library.
+ */
+typedef struct binc_gatt_tree_changes {
+    GList *added_services;
+    GList *removed_services;
+    GList *added_characteristics;
+    GList *removed_characteristics;
+    GList *added_descriptors;
+    GList *removed_descriptors;
+    guint services_kept;
+    guint characteristics_kept;
+    guint descriptors_kept;
+} GattTreeChanges;
+
+typedef void (*GattTreeChangedCallback)(Device *device, const GattTreeChanges *changes);
+
 typedef void (*BondingStateChangedCallback)(Device *device, BondingState new_state, BondingState old_state,
                                             const GError *error);
 
@@ -72,6 +91,12 @@ gboolean binc_device_write_char(const Device *device, const char *service_uuid,
 
 void binc_device_set_notify_char_cb(Device *device, OnNotifyCallback callback);
 
+/**
+ * Like binc_device_set_notify_char_cb but the callback also gets the receive time and sequence number.
+ * When set, it is used instead of the callback set with binc_device_set_notify_char_cb.
+ */
+void binc_device_set_notify_char_ext_cb(Device *device, OnNotifyExtCallback callback);
+
 void binc_device_set_notify_state_cb(Device *device, OnNotifyingStateChangedCallback callback);
 
 gboolean binc_device_start_notify(const Device *device, const char *service_uuid, const char *characteristic_uuid);
@@ -92,6 +117,11 @@ void binc_device_set_connection_state_change_cb(Device *device, ConnectionStateC
 
 void binc_device_set_services_resolved_cb(Device *device, ServicesResolvedCallback callback);
 
+/**
+ * Set a callback that reports what changed in the GATT tree, called right before the services resolved callback
+ */
+void binc_device_set_gatt_tree_changed_cb(Device *device, GattTreeChangedCallback callback);
+
 void binc_device_set_bonding_state_changed_cb(Device *device, BondingStateChangedCallback callback);
 
 gboolean binc_device_has_service(const Device *device, const char *service_uuid);
@@ -25,6 +25,7 @@
 #define BINC_DEVICE_INTERNAL_H
 
 #include "device.h"
+#include "allocator.h"
 
 Device *binc_device_create(const char *path, Adapter *adapter);
 
@@ -62,6 +63,10 @@ void binc_device_set_bonding_state(Device *device, BondingState bonding_state);
 
 void binc_device_set_is_central(Device *device, gboolean is_central);
 
+Arena *binc_device_get_gatt_arena(const Device *device);
+
+gsize binc_device_get_struct_size(void);
+
 void binc_internal_device_update_property(Device *device, const char *property_name, GVariant *property_value);
 
 #endif //BINC_DEVICE_INTERNAL_H
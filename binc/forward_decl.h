@@ -37,6 +37,8 @@ typedef struct binc_descriptor Descriptor;
 typedef struct binc_service_handler_manager ServiceHandlerManager;
 typedef struct binc_advertisement Advertisement;
 typedef struct binc_application Application;
+typedef struct binc_connection_manager ConnectionManager;
+typedef struct binc_advertising_scheduler AdvertisingScheduler;
 
 #ifdef __cplusplus
 }
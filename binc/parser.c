@@ -22,9 +22,33 @@
  */
 
 #include "parser.h"
+#include "builder.h"
 #include "math.h"
+#include <string.h>
 #include <time.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define PARSER_USE_SSE2
+#if defined(__GNUC__)
+#define PARSER_USE_F16C
+#endif
+#elif defined(__aarch64__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#include <arm_neon.h>
+#define PARSER_USE_NEON
+#endif
+
+// External definitions of the inline functions in parser.h
+extern gboolean parser_has_error(const Parser *parser);
+extern guint parser_get_remaining(const Parser *parser);
+extern gboolean parser_ensure(Parser *parser, guint size);
+extern guint8 parser_get_uint8(Parser *parser);
+extern gint8 parser_get_sint8(Parser *parser);
+extern guint16 parser_get_uint16(Parser *parser);
+extern gint16 parser_get_sint16(Parser *parser);
+extern guint32 parser_get_uint24(Parser *parser);
+extern guint32 parser_get_uint32(Parser *parser);
+
 // IEEE 11073 Reserved float values
 typedef enum {
     MDER_POSITIVE_INFINITY = 0x007FFFFE,
@@ -34,12 +58,6 @@ typedef enum {
     MDER_NEGATIVE_INFINITY = 0x00800002
 } ReservedFloatValues;
 
-struct parser_instance {
-    const GByteArray *bytes;
-    guint offset;
-    int byteOrder;
-};
-
 static const double reserved_float_values[5] = {MDER_POSITIVE_INFINITY, MDER_NaN, MDER_NaN, MDER_NaN,
                                                 MDER_NEGATIVE_INFINITY};
 
@@ -50,121 +68,108 @@ static const double reserved_float_values[5] = {MDER_POSITIVE_INFINITY, MDER_NaN
 #define BINARY32_IMPLIED_BIT 0x800000
 #define BINARY32_SHIFT_EXPO 23
 
-Parser *parser_create(const GByteArray *bytes, int byteOrder) {
-    Parser *parser = g_new0(Parser, 1);
-    parser->bytes = bytes;
+// IEEE 11073 Reserved SFLOAT values
+#define SFLOAT_POSITIVE_INFINITY 0x07FE
+#define SFLOAT_NaN 0x07FF
+#define SFLOAT_NRes 0x0800
+#define SFLOAT_RESERVED_VALUE 0x0801
+#define SFLOAT_NEGATIVE_INFINITY 0x0802
+
+// Powers of ten indexed by the 4-bit SFLOAT exponent (0..7, -8..-1)
+static const double sfloat_exponents[16] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                            1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1};
+
+static const guint sample_sizes[] = {2, 2, 3, 2, 2};
+
+void parser_init(Parser *parser, const guint8 *data, guint length, int byteOrder) {
+    g_assert(parser != NULL);
+    g_assert(data != NULL || length == 0);
+
+    parser->data = data;
+    parser->length = length;
     parser->offset = 0;
     parser->byteOrder = byteOrder;
+    parser->error = FALSE;
+}
+
+Parser *parser_create(const GByteArray *bytes, int byteOrder) {
+    g_assert(bytes != NULL);
+
+    Parser *parser = g_new0(Parser, 1);
+    parser_init(parser, bytes->data, bytes->len, byteOrder);
     return parser;
 }
 
 void parser_free(Parser *parser) {
     g_assert(parser != NULL);
-    parser->bytes = NULL;
+    parser->data = NULL;
     g_free(parser);
 }
 
 void parser_set_offset(Parser *parser, guint offset) {
     g_assert(parser != NULL);
-    parser->offset = offset;
-}
-
-guint8 parser_get_uint8(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert(parser->offset < parser->bytes->len);
-
-    guint8 result = parser->bytes->data[parser->offset];
-    parser->offset = parser->offset + 1;
-    return result;
-}
 
-gint8 parser_get_sint8(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert(parser->offset < parser->bytes->len);
-
-    gint8 result = (gint8) parser->bytes->data[parser->offset];
-    parser->offset = parser->offset + 1;
-    return result;
-}
-
-guint16 parser_get_uint16(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert((parser->offset + 1) < parser->bytes->len);
-
-    guint8 byte1, byte2;
-    byte1 = parser->bytes->data[parser->offset];
-    byte2 = parser->bytes->data[parser->offset + 1];
-    parser->offset = parser->offset + 2;
-    if (parser->byteOrder == LITTLE_ENDIAN) {
-        return (guint16) ((byte2 << 8) + byte1);
-    } else {
-        return (guint16) ((byte1 << 8) + byte2);
+    if (offset > parser->length) {
+        parser->error = TRUE;
+        offset = parser->length;
     }
+    parser->offset = offset;
 }
 
-gint16 parser_get_sint16(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert((parser->offset + 1) < parser->bytes->len);
-
-    guint8 byte1, byte2;
-    byte1 = parser->bytes->data[parser->offset];
-    byte2 = parser->bytes->data[parser->offset + 1];
-    parser->offset = parser->offset + 2;
-    if (parser->byteOrder == LITTLE_ENDIAN) {
-        return (gint16) ((byte2 << 8) + byte1);
-    } else {
-        return (gint16) ((byte1 << 8) + byte2);
+static inline double sfloat_to_double(guint16 sfloat) {
+    switch (sfloat) {
+        case SFLOAT_POSITIVE_INFINITY:
+            return INFINITY;
+        case SFLOAT_NEGATIVE_INFINITY:
+            return -INFINITY;
+        case SFLOAT_NaN:
+        case SFLOAT_NRes:
+        case SFLOAT_RESERVED_VALUE:
+            return NAN;
+        default:
+            break;
     }
-}
 
-guint32 parser_get_uint24(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert((parser->offset + 2) < parser->bytes->len);
-
-    guint8 byte1, byte2, byte3;
-    byte1 = parser->bytes->data[parser->offset];
-    byte2 = parser->bytes->data[parser->offset+1];
-    byte3 = parser->bytes->data[parser->offset+2];
-    parser->offset = parser->offset + 3;
-    if (parser->byteOrder == LITTLE_ENDIAN) {
-        return (guint32) ((byte3 << 16) + (byte2 << 8) + byte1);
-    } else {
-        return (guint32) ((byte1 << 16) + (byte2 << 8) + byte3);
+    int mantissa = sfloat & 0xfff;
+    if (mantissa >= 0x800) {
+        mantissa = mantissa - 0x1000;
     }
+    return mantissa * sfloat_exponents[sfloat >> 12];
 }
 
-guint32 parser_get_uint32(Parser *parser) {
-    g_assert(parser != NULL);
-    g_assert((parser->offset + 3) < parser->bytes->len);
-
-    guint8 byte1, byte2, byte3, byte4;
-    byte1 = parser->bytes->data[parser->offset];
-    byte2 = parser->bytes->data[parser->offset + 1];
-    byte3 = parser->bytes->data[parser->offset + 2];
-    byte4 = parser->bytes->data[parser->offset + 3];
-    parser->offset = parser->offset + 4;
-    if (parser->byteOrder == LITTLE_ENDIAN) {
-        return (guint32) ((byte4 << 24) + (byte3 << 16) + (byte2 << 8) + byte1);
+static inline float half_to_float(guint16 half) {
+    guint32 sign = (guint32) (half & 0x8000) << 16;
+    guint32 exponent = (half >> 10) & 0x1f;
+    guint32 fraction = half & 0x3ff;
+    guint32 bits;
+
+    if (exponent == 0) {
+        if (fraction == 0) {
+            bits = sign;
+        } else {
+            // Subnormal, normalize it since all halfs are normal floats
+            exponent = 127 - 14;
+            while ((fraction & 0x400) == 0) {
+                fraction <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((fraction & 0x3ff) << 13);
+        }
+    } else if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (fraction << 13);
     } else {
-        return (guint32) ((byte1 << 24) + (byte2 << 16) + (byte3 << 8) + byte4);
+        bits = sign | ((exponent + 127 - 15) << 23) | (fraction << 13);
     }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
 }
 
 double parser_get_sfloat(Parser *parser) {
     g_assert(parser != NULL);
-    g_assert(parser->offset < parser->bytes->len);
-
-    guint16 sfloat = parser_get_uint16(parser);
 
-    int mantissa = sfloat & 0xfff;
-    if (mantissa >= 0x800) {
-        mantissa = mantissa - 0x1000;
-    }
-    int exponent = sfloat >> 12;
-    if (exponent >= 0x8) {
-        exponent = exponent - 0x10;
-    }
-    return (mantissa * pow(10.0, exponent));
+    return sfloat_to_double(parser_get_uint16(parser));
 }
 
 /* round number n to d decimal points */
@@ -229,106 +234,283 @@ double parser_get_754float(Parser *parser) {
 
 double parser_get_754half(Parser *parser) {
     g_assert(parser != NULL);
-    g_assert(parser->offset < parser->bytes->len);
-
-    guint16 value = parser_get_uint16(parser);
-
-    gboolean sign = ((value & 0x8000) != 0);
-	guint16 exponent = (value & 0x7c00) >> 10;
-	guint16 fraction = value & 0x300;
-	
-	float result = 0.0;
-
-	if (exponent == 0) {
-		if (fraction == 0) {
-			return (0.0);
-		}
-		else {
-			result = (float) (pow(-1, sign) * pow(2, -14) * ((float) fraction / 1024));
-		}
-	}
-	else if (exponent == 0x1f) {
-		if (fraction == 0) return (INFINITY);
-		else return (NAN);
-	}
-	else {
-		result = (float) (pow(-1, sign) * pow(2, exponent - 15) * (1.0 + (float) fraction / 1024));
-	}
-	
-	return (result);
+
+    return half_to_float(parser_get_uint16(parser));
+}
+
+static inline guint16 read_uint16(const guint8 *p, gboolean little_endian) {
+    return little_endian ? (guint16) ((p[1] << 8) | p[0]) : (guint16) ((p[0] << 8) | p[1]);
+}
+
+static inline guint32 read_uint24(const guint8 *p, gboolean little_endian) {
+    return little_endian ? ((guint32) p[2] << 16) | ((guint32) p[1] << 8) | p[0]
+                         : ((guint32) p[0] << 16) | ((guint32) p[1] << 8) | p[2];
+}
+
+#if defined(PARSER_USE_SSE2)
+static inline __m128i swap_bytes16(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline void widen16(__m128i v, gboolean is_signed, __m128i *low, __m128i *high) {
+    if (is_signed) {
+        *low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        *high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    } else {
+        *low = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+        *high = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+    }
+}
+#endif
+
+/*
+ * Widen 16-bit integers 8 at a time, returns the number of values converted so the caller can do the tail
+ */
+static guint convert_int16_vector(const guint8 *data, guint count, gboolean little_endian, gboolean is_signed,
+                                  gint32 *ints, float *floats) {
+    guint i = 0;
+#if defined(PARSER_USE_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (data + i * 2));
+        if (!little_endian) v = swap_bytes16(v);
+
+        __m128i low, high;
+        widen16(v, is_signed, &low, &high);
+        if (ints != NULL) {
+            _mm_storeu_si128((__m128i *) (ints + i), low);
+            _mm_storeu_si128((__m128i *) (ints + i + 4), high);
+        } else {
+            _mm_storeu_ps(floats + i, _mm_cvtepi32_ps(low));
+            _mm_storeu_ps(floats + i + 4, _mm_cvtepi32_ps(high));
+        }
+    }
+#elif defined(PARSER_USE_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint8x16_t bytes = vld1q_u8(data + i * 2);
+        if (!little_endian) bytes = vrev16q_u8(bytes);
+
+        int32x4_t low, high;
+        if (is_signed) {
+            int16x8_t v = vreinterpretq_s16_u8(bytes);
+            low = vmovl_s16(vget_low_s16(v));
+            high = vmovl_s16(vget_high_s16(v));
+        } else {
+            uint16x8_t v = vreinterpretq_u16_u8(bytes);
+            low = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v)));
+            high = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v)));
+        }
+        if (ints != NULL) {
+            vst1q_s32(ints + i, low);
+            vst1q_s32(ints + i + 4, high);
+        } else {
+            vst1q_f32(floats + i, vcvtq_f32_s32(low));
+            vst1q_f32(floats + i + 4, vcvtq_f32_s32(high));
+        }
+    }
+#endif
+    return i;
+}
+
+#if defined(PARSER_USE_F16C)
+__attribute__((target("f16c")))
+static guint convert_half_f16c(const guint8 *data, guint count, gboolean little_endian, float *floats) {
+    guint i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (data + i * 2));
+        if (!little_endian) v = swap_bytes16(v);
+        _mm256_storeu_ps(floats + i, _mm256_cvtph_ps(v));
+    }
+    return i;
+}
+#endif
+
+/*
+ * Convert halfs 8 at a time if the CPU can, returns the number of values converted
+ */
+static guint convert_half_vector(const guint8 *data, guint count, gboolean little_endian, float *floats) {
+#if defined(PARSER_USE_F16C)
+    if (__builtin_cpu_supports("f16c")) {
+        return convert_half_f16c(data, count, little_endian, floats);
+    }
+    return 0;
+#elif defined(PARSER_USE_NEON)
+    guint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint8x8_t bytes = vld1_u8(data + i * 2);
+        if (!little_endian) bytes = vrev16_u8(bytes);
+        vst1q_f32(floats + i, vcvt_f32_f16(vreinterpret_f16_u8(bytes)));
+    }
+    return i;
+#else
+    return 0;
+#endif
+}
+
+static gboolean parser_take_samples(Parser *parser, ParserSampleFormat format, guint count, const guint8 **data) {
+    g_assert(format <= PARSER_SAMPLE_754HALF);
+
+    guint size = sample_sizes[format];
+    if (count > G_MAXUINT / size || !parser_ensure(parser, count * size)) {
+        parser->error = TRUE;
+        return FALSE;
+    }
+
+    *data = parser->data + parser->offset;
+    parser->offset += count * size;
+    return TRUE;
+}
+
+gboolean parser_get_float_array(Parser *parser, ParserSampleFormat format, float *values, guint count) {
+    g_assert(parser != NULL);
+    g_assert(values != NULL || count == 0);
+
+    const guint8 *data;
+    if (!parser_take_samples(parser, format, count, &data)) return FALSE;
+
+    gboolean little_endian = parser->byteOrder == LITTLE_ENDIAN;
+    guint i = 0;
+    switch (format) {
+        case PARSER_SAMPLE_SINT16:
+        case PARSER_SAMPLE_UINT16: {
+            gboolean is_signed = format == PARSER_SAMPLE_SINT16;
+            i = convert_int16_vector(data, count, little_endian, is_signed, NULL, values);
+            for (; i < count; i++) {
+                guint16 raw = read_uint16(data + i * 2, little_endian);
+                values[i] = is_signed ? (float) (gint16) raw : (float) raw;
+            }
+            break;
+        }
+        case PARSER_SAMPLE_UINT24:
+            // Separate loops so the byte order is a constant and the compiler can vectorize
+            if (little_endian) {
+                for (; i < count; i++) values[i] = (float) read_uint24(data + i * 3, TRUE);
+            } else {
+                for (; i < count; i++) values[i] = (float) read_uint24(data + i * 3, FALSE);
+            }
+            break;
+        case PARSER_SAMPLE_SFLOAT:
+            if (little_endian) {
+                for (; i < count; i++) values[i] = (float) sfloat_to_double(read_uint16(data + i * 2, TRUE));
+            } else {
+                for (; i < count; i++) values[i] = (float) sfloat_to_double(read_uint16(data + i * 2, FALSE));
+            }
+            break;
+        case PARSER_SAMPLE_754HALF:
+            i = convert_half_vector(data, count, little_endian, values);
+            for (; i < count; i++) {
+                values[i] = half_to_float(read_uint16(data + i * 2, little_endian));
+            }
+            break;
+    }
+    return TRUE;
+}
+
+gboolean parser_get_int32_array(Parser *parser, ParserSampleFormat format, gint32 *values, guint count) {
+    g_assert(parser != NULL);
+    g_assert(values != NULL || count == 0);
+    g_assert(format == PARSER_SAMPLE_SINT16 || format == PARSER_SAMPLE_UINT16 || format == PARSER_SAMPLE_UINT24);
+
+    const guint8 *data;
+    if (!parser_take_samples(parser, format, count, &data)) return FALSE;
+
+    gboolean little_endian = parser->byteOrder == LITTLE_ENDIAN;
+    guint i = 0;
+    if (format == PARSER_SAMPLE_UINT24) {
+        if (little_endian) {
+            for (; i < count; i++) values[i] = (gint32) read_uint24(data + i * 3, TRUE);
+        } else {
+            for (; i < count; i++) values[i] = (gint32) read_uint24(data + i * 3, FALSE);
+        }
+    } else {
+        gboolean is_signed = format == PARSER_SAMPLE_SINT16;
+        i = convert_int16_vector(data, count, little_endian, is_signed, values, NULL);
+        for (; i < count; i++) {
+            guint16 raw = read_uint16(data + i * 2, little_endian);
+            values[i] = is_signed ? (gint32) (gint16) raw : (gint32) raw;
+        }
+    }
+    return TRUE;
+}
+
+ParserStringView parser_get_string_view(Parser *parser) {
+    g_assert(parser != NULL);
+
+    ParserStringView view;
+    view.data = (const char *) parser->data + parser->offset;
+    view.length = parser_get_remaining(parser);
+    parser->offset = parser->length;
+    return view;
 }
 
 GString *parser_get_string(Parser *parser) {
     g_assert(parser != NULL);
-    g_assert(parser->bytes != NULL);
 
-    return g_string_new_len((const char *) parser->bytes->data + parser->offset,
-                            (gssize) (parser->bytes->len - parser->offset));
+    ParserStringView view = parser_get_string_view(parser);
+    return g_string_new_len(view.data, (gssize) view.length);
+}
+
+ParserDateTime parser_get_plain_date_time(Parser *parser) {
+    g_assert(parser != NULL);
+
+    ParserDateTime date_time;
+    date_time.year = parser_get_uint16(parser);
+    date_time.month = parser_get_uint8(parser);
+    date_time.day = parser_get_uint8(parser);
+    date_time.hours = parser_get_uint8(parser);
+    date_time.minutes = parser_get_uint8(parser);
+    date_time.seconds = parser_get_uint8(parser);
+    return date_time;
 }
 
 GDateTime *parser_get_date_time(Parser *parser) {
     g_assert(parser != NULL);
 
-    guint16 year = parser_get_uint16(parser);
-    guint8 month = parser_get_uint8(parser);
-    guint8 day = parser_get_uint8(parser);
-    guint8 hour = parser_get_uint8(parser);
-    guint8 min = parser_get_uint8(parser);
-    guint8 sec = parser_get_uint8(parser);
+    ParserDateTime date_time = parser_get_plain_date_time(parser);
+    if (parser->error) return NULL;
 
-    return g_date_time_new_local(year, month, day, hour, min, sec);
+    // Returns NULL for out of range values, e.g. the 'unknown' year or month 0
+    return g_date_time_new_local(date_time.year, date_time.month, date_time.day,
+                                 date_time.hours, date_time.minutes, date_time.seconds);
 }
 
-GByteArray *binc_get_current_time(void) {
-    GByteArray *byteArray = g_byte_array_new();
+static ParserDateTime binc_internal_date_time_from(GDateTime *dateTime) {
+    ParserDateTime result;
+    result.year = (guint16) g_date_time_get_year(dateTime);
+    result.month = (guint8) g_date_time_get_month(dateTime);
+    result.day = (guint8) g_date_time_get_day_of_month(dateTime);
+    result.hours = (guint8) g_date_time_get_hour(dateTime);
+    result.minutes = (guint8) g_date_time_get_minute(dateTime);
+    result.seconds = (guint8) g_date_time_get_second(dateTime);
+    return result;
+}
 
+GByteArray *binc_get_current_time(void) {
     GDateTime *now = g_date_time_new_now_local();
-    guint year = (guint) g_date_time_get_year(now);
-    guint8 yearLsb = year & 0xFF;
-    guint8 yearMsb = (guint8) (year >> 8);
-    guint8 month = (guint8) g_date_time_get_month(now);
-    guint8 day = (guint8) g_date_time_get_day_of_month(now);
-    guint8 hours = (guint8) g_date_time_get_hour(now);
-    guint8 minutes = (guint8) g_date_time_get_minute(now);
-    guint8 seconds = (guint8) g_date_time_get_second(now);
+    ParserDateTime dateTime = binc_internal_date_time_from(now);
     guint8 dayOfWeek = (guint8) g_date_time_get_day_of_week(now);
-    guint8 miliseconds = (guint8) ((g_date_time_get_microsecond(now) / 1000) * 256 / 1000);
-    guint8 reason = 1;
+    guint8 fractions256 = (guint8) ((g_date_time_get_microsecond(now) / 1000) * 256 / 1000);
     g_date_time_unref(now);
 
-    g_byte_array_append(byteArray, &yearLsb, 1);
-    g_byte_array_append(byteArray, &yearMsb, 1);
-    g_byte_array_append(byteArray, &month, 1);
-    g_byte_array_append(byteArray, &day, 1);
-    g_byte_array_append(byteArray, &hours, 1);
-    g_byte_array_append(byteArray, &minutes, 1);
-    g_byte_array_append(byteArray, &seconds, 1);
-    g_byte_array_append(byteArray, &dayOfWeek, 1);
-    g_byte_array_append(byteArray, &miliseconds, 1);
-    g_byte_array_append(byteArray, &reason, 1);
+    GByteArray *byteArray = g_byte_array_sized_new(10);
+    Builder builder;
+    builder_init_byte_array(&builder, byteArray, 10, LITTLE_ENDIAN);
+    builder_put_date_time(&builder, &dateTime);
+    builder_put_uint8(&builder, dayOfWeek);
+    builder_put_uint8(&builder, fractions256);
+    builder_put_uint8(&builder, 1); // Adjust reason: manual time update
+    builder_finish(&builder);
     return byteArray;
 }
 
 GByteArray *binc_get_date_time(void) {
-    GByteArray *byteArray = g_byte_array_new();
-
     GDateTime *now = g_date_time_new_now_local();
-    guint year = (guint) g_date_time_get_year(now);
-    guint8 yearLsb = year & 0xFF;
-    guint8 yearMsb = (guint8) (year >> 8);
-    guint8 month = (guint8) g_date_time_get_month(now);
-    guint8 day = (guint8) g_date_time_get_day_of_month(now);
-    guint8 hours = (guint8) g_date_time_get_hour(now);
-    guint8 minutes = (guint8) g_date_time_get_minute(now);
-    guint8 seconds = (guint8) g_date_time_get_second(now);
+    ParserDateTime dateTime = binc_internal_date_time_from(now);
     g_date_time_unref(now);
 
-    g_byte_array_append(byteArray, &yearLsb, 1);
-    g_byte_array_append(byteArray, &yearMsb, 1);
-    g_byte_array_append(byteArray, &month, 1);
-    g_byte_array_append(byteArray, &day, 1);
-    g_byte_array_append(byteArray, &hours, 1);
-    g_byte_array_append(byteArray, &minutes, 1);
-    g_byte_array_append(byteArray, &seconds, 1);
+    GByteArray *byteArray = g_byte_array_sized_new(7);
+    Builder builder;
+    builder_init_byte_array(&builder, byteArray, 7, LITTLE_ENDIAN);
+    builder_put_date_time(&builder, &dateTime);
+    builder_finish(&builder);
     return byteArray;
 }
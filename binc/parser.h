@@ -31,14 +31,67 @@
 extern "C" {
 #endif
 
-typedef struct parser_instance Parser;
+/**
+ * Parser over a byte buffer. It can live on the stack, see parser_init.
+ *
+ * Reading past the end of the buffer does not abort but sets the error flag and returns 0.
+ * The flag is sticky, so a sequence of reads can be checked once at the end with parser_has_error.
+ */
+typedef struct parser_instance {
+    const guint8 *data; // Borrowed
+    guint length;
+    guint offset;
+    int byteOrder;
+    gboolean error;
+} Parser;
+
+/**
+ * Plain date time as used in GATT characteristics (Date Time, 0x2A08)
+ */
+typedef struct parser_date_time {
+    guint16 year;
+    guint8 month;
+    guint8 day;
+    guint8 hours;
+    guint8 minutes;
+    guint8 seconds;
+} ParserDateTime;
+
+/**
+ * View on a string inside the parsed buffer. It is not NUL-terminated and only valid as long as the buffer is.
+ */
+typedef struct parser_string_view {
+    const char *data;
+    guint length;
+} ParserStringView;
+
+/**
+ * Formats for decoding arrays of samples
+ */
+typedef enum ParserSampleFormat {
+    PARSER_SAMPLE_SINT16 = 0,
+    PARSER_SAMPLE_UINT16 = 1,
+    PARSER_SAMPLE_UINT24 = 2,
+    PARSER_SAMPLE_SFLOAT = 3,
+    PARSER_SAMPLE_754HALF = 4
+} ParserSampleFormat;
+
+/**
+ * Initialize a parser, typically one allocated on the stack
+ *
+ * @param parser the parser to initialize
+ * @param data the bytes to parse, not copied
+ * @param length the number of bytes
+ * @param byteOrder either LITTLE_ENDIAN or BIG_ENDIAN
+ */
+void parser_init(Parser *parser, const guint8 *data, guint length, int byteOrder);
 
 /**
  * Create a parser for a byte array
  *
  * @param bytes the byte array
  * @param byteOrder either LITTLE_ENDIAN or BIG_ENDIAN
- * @return parser object
+ * @return parser object, free with parser_free
  */
 Parser *parser_create(const GByteArray *bytes, int byteOrder);
 
@@ -46,18 +99,82 @@ void parser_set_offset(Parser *parser, guint offset);
 
 void parser_free(Parser *parser);
 
-guint8 parser_get_uint8(Parser *parser);
+/*
+ * The functions below are inline for speed. parser.c also provides external definitions, so they stay exported
+ * from the library.
+ */
+
+inline gboolean parser_has_error(const Parser *parser) {
+    return parser->error;
+}
+
+inline guint parser_get_remaining(const Parser *parser) {
+    return parser->length - parser->offset;
+}
 
-gint8 parser_get_sint8(Parser *parser);
+/**
+ * Check that size bytes can be read, sets the error flag otherwise
+ */
+inline gboolean parser_ensure(Parser *parser, guint size) {
+    if (parser->error || parser->length - parser->offset < size) {
+        parser->error = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
 
-guint16 parser_get_uint16(Parser *parser);
+inline guint8 parser_get_uint8(Parser *parser) {
+    if (!parser_ensure(parser, 1)) return 0;
+    return parser->data[parser->offset++];
+}
 
-gint16 parser_get_sint16(Parser *parser);
+inline gint8 parser_get_sint8(Parser *parser) {
+    return (gint8) parser_get_uint8(parser);
+}
 
-guint32 parser_get_uint24(Parser *parser);
+inline guint16 parser_get_uint16(Parser *parser) {
+    if (!parser_ensure(parser, 2)) return 0;
 
-guint32 parser_get_uint32(Parser *parser);
+    const guint8 *p = parser->data + parser->offset;
+    parser->offset += 2;
+    if (parser->byteOrder == LITTLE_ENDIAN) {
+        return (guint16) ((p[1] << 8) | p[0]);
+    } else {
+        return (guint16) ((p[0] << 8) | p[1]);
+    }
+}
 
+inline gint16 parser_get_sint16(Parser *parser) {
+    return (gint16) parser_get_uint16(parser);
+}
+
+inline guint32 parser_get_uint24(Parser *parser) {
+    if (!parser_ensure(parser, 3)) return 0;
+
+    const guint8 *p = parser->data + parser->offset;
+    parser->offset += 3;
+    if (parser->byteOrder == LITTLE_ENDIAN) {
+        return ((guint32) p[2] << 16) | ((guint32) p[1] << 8) | p[0];
+    } else {
+        return ((guint32) p[0] << 16) | ((guint32) p[1] << 8) | p[2];
+    }
+}
+
+inline guint32 parser_get_uint32(Parser *parser) {
+    if (!parser_ensure(parser, 4)) return 0;
+
+    const guint8 *p = parser->data + parser->offset;
+    parser->offset += 4;
+    if (parser->byteOrder == LITTLE_ENDIAN) {
+        return ((guint32) p[3] << 24) | ((guint32) p[2] << 16) | ((guint32) p[1] << 8) | p[0];
+    } else {
+        return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) | ((guint32) p[2] << 8) | p[3];
+    }
+}
+
+/**
+ * Read an IEEE 11073 SFLOAT. The reserved values are returned as INFINITY, -INFINITY or NAN.
+ */
 double parser_get_sfloat(Parser *parser);
 
 double parser_get_float(Parser *parser);
@@ -66,12 +183,46 @@ double parser_get_754half(Parser *parser);
 
 double parser_get_754float(Parser *parser);
 
+/**
+ * Decode count consecutive samples into values, using SIMD where available
+ *
+ * @param parser the parser, its byte order is used for all samples
+ * @param format the sample format
+ * @param values caller-provided array of at least count floats
+ * @param count number of samples to decode
+ * @return TRUE if successful. If there are not enough bytes, nothing is read and the error flag is set.
+ */
+gboolean parser_get_float_array(Parser *parser, ParserSampleFormat format, float *values, guint count);
+
+/**
+ * Like parser_get_float_array but for integer formats (SINT16, UINT16 and UINT24)
+ */
+gboolean parser_get_int32_array(Parser *parser, ParserSampleFormat format, gint32 *values, guint count);
+
+/**
+ * Read a Date Time (7 bytes) without allocating
+ */
+ParserDateTime parser_get_plain_date_time(Parser *parser);
+
+/**
+ * Read a Date Time (7 bytes) as a GDateTime
+ *
+ * @return the date time in the local timezone, or NULL if it could not be read or is invalid. Caller must unref.
+ */
 GDateTime* parser_get_date_time(Parser *parser);
 
 GByteArray* binc_get_date_time(void);
 
 GByteArray *binc_get_current_time(void);
 
+/**
+ * Get the remaining bytes as a string view, without copying
+ */
+ParserStringView parser_get_string_view(Parser *parser);
+
+/**
+ * Get the remaining bytes as a newly allocated string, caller must free. Moves the offset to the end.
+ */
 GString *parser_get_string(Parser *parser);
 
 #ifdef __cplusplus
@@ -0,0 +1,275 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#include "schema.h"
+#include "logger.h"
+#include <string.h>
+
+static const char *const TAG = "Schema";
+
+#define OP_REPEAT 0xFF
+
+// Bytes on the wire and bytes in the result struct, indexed by SchemaType
+static const guint wire_sizes[] = {1, 1, 2, 2, 3, 4, 2, 4, 2, 4, 7};
+static const gsize storage_sizes[] = {sizeof(guint8), sizeof(gint8), sizeof(guint16), sizeof(gint16),
+                                      sizeof(guint32), sizeof(guint32), sizeof(double), sizeof(double),
+                                      sizeof(double), sizeof(double), sizeof(ParserDateTime)};
+
+typedef struct schema_instruction {
+    guint8 op; // SchemaType or OP_REPEAT
+    gboolean is_flags;
+    guint32 mask;
+    gsize offset;
+    gsize aux_offset;
+    guint max_count;
+    gsize stride;
+    guint body_length; // Number of instructions in a repeated group
+    guint element_size; // Bytes on the wire of one repeated element
+} SchemaInstruction;
+
+struct binc_schema {
+    SchemaInstruction *instructions; // Owned
+    guint length;
+    gsize result_size;
+    int byteOrder;
+};
+
+static const char *binc_internal_schema_check_value(const SchemaField *field, const SchemaInstruction *repeat,
+                                                    gsize result_size) {
+    if (field->type > SCHEMA_DATE_TIME) return "unknown type";
+
+    gsize limit = repeat != NULL ? repeat->stride : result_size;
+    if (field->offset > limit || storage_sizes[field->type] > limit - field->offset) return "value out of bounds";
+
+    if (field->kind == SCHEMA_KIND_FLAGS && field->type > SCHEMA_UINT32) return "flags must be an integer";
+
+    if (repeat != NULL && (field->mask != 0 || field->kind == SCHEMA_KIND_FLAGS)) {
+        return "flags and optional values are not supported in a repeated group";
+    }
+
+    if (field->mask != 0 && field->aux_offset != SCHEMA_NO_OFFSET &&
+        (field->aux_offset > result_size || sizeof(gboolean) > result_size - field->aux_offset)) {
+        return "presence flag out of bounds";
+    }
+    return NULL;
+}
+
+static const char *binc_internal_schema_check_repeat(const SchemaField *field, gsize result_size) {
+    if (field->stride == 0 || field->max_count == 0) return "empty repeated group";
+    if (field->offset > result_size || field->max_count > (result_size - field->offset) / field->stride) {
+        return "array out of bounds";
+    }
+    if (field->aux_offset == SCHEMA_NO_OFFSET || field->aux_offset > result_size ||
+        sizeof(guint) > result_size - field->aux_offset) {
+        return "count out of bounds";
+    }
+    return NULL;
+}
+
+Schema *binc_schema_compile(const SchemaField *fields, guint n_fields, gsize result_size, int byteOrder) {
+    g_assert(fields != NULL);
+    g_assert(n_fields > 0);
+    g_assert(result_size > 0);
+
+    SchemaInstruction *instructions = g_new0(SchemaInstruction, n_fields);
+    SchemaInstruction *repeat = NULL;
+    guint length = 0;
+    const char *error = NULL;
+    guint i;
+
+    for (i = 0; i < n_fields && error == NULL; i++) {
+        const SchemaField *field = &fields[i];
+        switch (field->kind) {
+            case SCHEMA_KIND_VALUE:
+            case SCHEMA_KIND_FLAGS: {
+                error = binc_internal_schema_check_value(field, repeat, result_size);
+                if (error != NULL) break;
+
+                SchemaInstruction *instruction = &instructions[length++];
+                instruction->op = (guint8) field->type;
+                instruction->is_flags = field->kind == SCHEMA_KIND_FLAGS;
+                instruction->mask = field->mask;
+                instruction->offset = field->offset;
+                instruction->aux_offset = field->mask != 0 ? field->aux_offset : SCHEMA_NO_OFFSET;
+                if (repeat != NULL) {
+                    repeat->element_size += wire_sizes[field->type];
+                    repeat->body_length++;
+                }
+                break;
+            }
+            case SCHEMA_KIND_REPEAT: {
+                if (repeat != NULL) {
+                    error = "nested repeated groups are not supported";
+                    break;
+                }
+                error = binc_internal_schema_check_repeat(field, result_size);
+                if (error != NULL) break;
+
+                repeat = &instructions[length++];
+                repeat->op = OP_REPEAT;
+                repeat->mask = field->mask;
+                repeat->offset = field->offset;
+                repeat->aux_offset = field->aux_offset;
+                repeat->max_count = field->max_count;
+                repeat->stride = field->stride;
+                break;
+            }
+            case SCHEMA_KIND_REPEAT_END:
+                if (repeat == NULL) {
+                    error = "end without repeated group";
+                } else if (repeat->body_length == 0) {
+                    error = "empty repeated group";
+                }
+                repeat = NULL;
+                break;
+            default:
+                error = "unknown field kind";
+                break;
+        }
+    }
+
+    if (error == NULL && repeat != NULL) {
+        error = "repeated group without end";
+    }
+
+    if (error != NULL) {
+        log_error(TAG, "invalid schema field %u: %s", i - 1, error);
+        g_free(instructions);
+        return NULL;
+    }
+
+    Schema *schema = g_new0(Schema, 1);
+    schema->instructions = instructions;
+    schema->length = length;
+    schema->result_size = result_size;
+    schema->byteOrder = byteOrder;
+    return schema;
+}
+
+void binc_schema_free(Schema *schema) {
+    g_assert(schema != NULL);
+
+    g_free(schema->instructions);
+    schema->instructions = NULL;
+    g_free(schema);
+}
+
+static inline guint32 binc_internal_schema_read(Parser *parser, const SchemaInstruction *instruction, guint8 *base) {
+    guint8 *target = base + instruction->offset;
+    switch (instruction->op) {
+        case SCHEMA_UINT8: {
+            guint8 value = parser_get_uint8(parser);
+            *target = value;
+            return value;
+        }
+        case SCHEMA_SINT8: {
+            guint8 value = parser_get_uint8(parser);
+            *(gint8 *) target = (gint8) value;
+            return value;
+        }
+        case SCHEMA_UINT16: {
+            guint16 value = parser_get_uint16(parser);
+            *(guint16 *) target = value;
+            return value;
+        }
+        case SCHEMA_SINT16: {
+            guint16 value = parser_get_uint16(parser);
+            *(gint16 *) target = (gint16) value;
+            return value;
+        }
+        case SCHEMA_UINT24: {
+            guint32 value = parser_get_uint24(parser);
+            *(guint32 *) target = value;
+            return value;
+        }
+        case SCHEMA_UINT32: {
+            guint32 value = parser_get_uint32(parser);
+            *(guint32 *) target = value;
+            return value;
+        }
+        case SCHEMA_SFLOAT:
+            *(double *) target = parser_get_sfloat(parser);
+            return 0;
+        case SCHEMA_FLOAT:
+            *(double *) target = parser_get_float(parser);
+            return 0;
+        case SCHEMA_754HALF:
+            *(double *) target = parser_get_754half(parser);
+            return 0;
+        case SCHEMA_754FLOAT:
+            *(double *) target = parser_get_754float(parser);
+            return 0;
+        case SCHEMA_DATE_TIME:
+            *(ParserDateTime *) target = parser_get_plain_date_time(parser);
+            return 0;
+        default:
+            g_assert_not_reached();
+    }
+    return 0;
+}
+
+gboolean binc_schema_decode(const Schema *schema, const guint8 *data, guint length, void *result) {
+    g_assert(schema != NULL);
+    g_assert(result != NULL);
+
+    Parser parser;
+    parser_init(&parser, data, length, schema->byteOrder);
+    memset(result, 0, schema->result_size);
+
+    guint8 *base = (guint8 *) result;
+    guint32 flags = 0;
+    for (guint pc = 0; pc < schema->length; pc++) {
+        const SchemaInstruction *instruction = &schema->instructions[pc];
+
+        if (instruction->mask != 0) {
+            gboolean present = (flags & instruction->mask) != 0;
+            if (instruction->op != OP_REPEAT && instruction->aux_offset != SCHEMA_NO_OFFSET) {
+                *(gboolean *) (base + instruction->aux_offset) = present;
+            }
+            if (!present) {
+                if (instruction->op == OP_REPEAT) pc += instruction->body_length;
+                continue;
+            }
+        }
+
+        if (instruction->op == OP_REPEAT) {
+            const SchemaInstruction *body = instruction + 1;
+            guint count = MIN(instruction->max_count, parser_get_remaining(&parser) / instruction->element_size);
+            for (guint i = 0; i < count; i++) {
+                guint8 *element = base + instruction->offset + i * instruction->stride;
+                for (guint j = 0; j < instruction->body_length; j++) {
+                    binc_internal_schema_read(&parser, &body[j], element);
+                }
+            }
+            *(guint *) (base + instruction->aux_offset) = count;
+            pc += instruction->body_length;
+            continue;
+        }
+
+        guint32 value = binc_internal_schema_read(&parser, instruction, base);
+        if (instruction->is_flags) {
+            flags = value;
+        }
+    }
+    return !parser_has_error(&parser);
+}
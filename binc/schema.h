@@ -0,0 +1,139 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+#ifndef BINC_SCHEMA_H
+#define BINC_SCHEMA_H
+
+#include <glib.h>
+#include <stddef.h>
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Wire types of schema fields. Each type is stored in the result struct as:
+ * UINT8 guint8, SINT8 gint8, UINT16 guint16, SINT16 gint16, UINT24 and UINT32 guint32,
+ * SFLOAT, FLOAT, 754HALF and 754FLOAT double, DATE_TIME ParserDateTime
+ */
+typedef enum SchemaType {
+    SCHEMA_UINT8 = 0,
+    SCHEMA_SINT8 = 1,
+    SCHEMA_UINT16 = 2,
+    SCHEMA_SINT16 = 3,
+    SCHEMA_UINT24 = 4,
+    SCHEMA_UINT32 = 5,
+    SCHEMA_SFLOAT = 6,
+    SCHEMA_FLOAT = 7,
+    SCHEMA_754HALF = 8,
+    SCHEMA_754FLOAT = 9,
+    SCHEMA_DATE_TIME = 10
+} SchemaType;
+
+typedef enum SchemaFieldKind {
+    SCHEMA_KIND_VALUE = 0,
+    SCHEMA_KIND_FLAGS = 1,
+    SCHEMA_KIND_REPEAT = 2,
+    SCHEMA_KIND_REPEAT_END = 3
+} SchemaFieldKind;
+
+#define SCHEMA_NO_OFFSET ((gsize) -1)
+
+/**
+ * One entry of a schema table, use the SCHEMA_* macros to create them
+ */
+typedef struct schema_field {
+    SchemaFieldKind kind;
+    SchemaType type;
+    gsize offset;
+    guint32 mask; // Only present if the flags have one of these bits set, 0 means always present
+    gsize aux_offset; // gboolean set to presence for optional values, guint element count for repeats
+    guint max_count;
+    gsize stride;
+} SchemaField;
+
+/**
+ * A value that is always present
+ */
+#define SCHEMA_VALUE(type, s, member) \
+    {SCHEMA_KIND_VALUE, type, offsetof(s, member), 0, SCHEMA_NO_OFFSET, 0, 0}
+
+/**
+ * A value that is used as flags for the conditions of the fields after it
+ */
+#define SCHEMA_FLAGS(type, s, member) \
+    {SCHEMA_KIND_FLAGS, type, offsetof(s, member), 0, SCHEMA_NO_OFFSET, 0, 0}
+
+/**
+ * A value that is only present if (flags & mask) != 0. Presence is stored in the gboolean present_member.
+ */
+#define SCHEMA_OPTIONAL(mask, type, s, member, present_member) \
+    {SCHEMA_KIND_VALUE, type, offsetof(s, member), mask, offsetof(s, present_member), 0, 0}
+
+/**
+ * Start of a group that repeats until the end of the payload, up to the number of elements of array_member.
+ * The number of elements read is stored in the guint count_member. Use mask 0 for a group that is always present.
+ */
+#define SCHEMA_REPEAT(mask, s, array_member, count_member) \
+    {SCHEMA_KIND_REPEAT, SCHEMA_UINT8, offsetof(s, array_member), mask, offsetof(s, count_member), \
+     (guint) (sizeof(((s *) 0)->array_member) / sizeof(((s *) 0)->array_member[0])), \
+     sizeof(((s *) 0)->array_member[0])}
+
+/**
+ * A value inside a repeated group, offset is relative to the element (0 for arrays of plain values)
+ */
+#define SCHEMA_ELEMENT(type, offset) \
+    {SCHEMA_KIND_VALUE, type, offset, 0, SCHEMA_NO_OFFSET, 0, 0}
+
+#define SCHEMA_REPEAT_END \
+    {SCHEMA_KIND_REPEAT_END, SCHEMA_UINT8, 0, 0, SCHEMA_NO_OFFSET, 0, 0}
+
+typedef struct binc_schema Schema;
+
+/**
+ * Compile a schema table into instructions
+ *
+ * @param fields the schema table, only used during compilation
+ * @param n_fields number of entries in the table
+ * @param result_size size of the struct that is filled by binc_schema_decode
+ * @param byteOrder either LITTLE_ENDIAN or BIG_ENDIAN
+ * @return the compiled schema or NULL if the table is invalid. Free with binc_schema_free.
+ */
+Schema *binc_schema_compile(const SchemaField *fields, guint n_fields, gsize result_size, int byteOrder);
+
+void binc_schema_free(Schema *schema);
+
+/**
+ * Decode a payload into result, which must be a struct of the result_size passed to binc_schema_compile.
+ * Fields that are not present are zeroed.
+ *
+ * @return TRUE if successful, FALSE if the payload is too short
+ */
+gboolean binc_schema_decode(const Schema *schema, const guint8 *data, guint length, void *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BINC_SCHEMA_H
@@ -24,11 +24,13 @@
 #include "service.h"
 #include "characteristic.h"
 #include "utility.h"
+#include "device_internal.h"
 
 struct binc_service {
     Device *device; // Borrowed
-    const char *path; // Owned
-    const char* uuid; // Owned
+    Arena *arena; // Owned reference
+    const char *path; // Owned by GATT arena
+    const char* uuid; // Owned by GATT arena
     GList *characteristics; // Owned
 };
 
@@ -37,10 +39,12 @@ Service* binc_service_create(Device *device, const char* path, const char* uuid)
     g_assert(path != NULL);
     g_assert(is_valid_uuid(uuid));
 
-    Service *service = g_new0(Service, 1);
+    Arena *arena = binc_device_get_gatt_arena(device);
+    Service *service = binc_arena_new0(arena, Service);
     service->device = device;
-    service->path = g_strdup(path);
-    service->uuid = g_strdup(uuid);
+    service->arena = binc_arena_ref(arena);
+    service->path = binc_arena_strdup(arena, path);
+    service->uuid = binc_arena_strdup(arena, uuid);
     service->characteristics = NULL;
     return service;
 }
@@ -48,17 +52,21 @@ Service* binc_service_create(Device *device, const char* path, const char* uuid)
 void binc_service_free(Service *service) {
     g_assert(service != NULL);
 
-    g_free((char*) service->path);
+    g_list_free(service->characteristics);
+    service->characteristics = NULL;
     service->path = NULL;
-
-    g_free((char*) service->uuid);
     service->uuid = NULL;
+    service->device = NULL;
 
-    g_list_free(service->characteristics);
-    service->characteristics = NULL;
+    // The struct and its strings live in the arena, so this must be the last thing we do
+    Arena *arena = service->arena;
+    service->arena = NULL;
+    binc_arena_unref(arena);
+}
 
-    service->device = NULL;
-    g_free(service);
+const char *binc_service_get_path(const Service *service) {
+    g_assert(service != NULL);
+    return service->path;
 }
 
 const char* binc_service_get_uuid(const Service *service) {
@@ -78,6 +86,13 @@ void binc_service_add_characteristic(Service *service, Characteristic *character
     service->characteristics = g_list_append(service->characteristics, characteristic);
 }
 
+void binc_service_remove_characteristic(Service *service, Characteristic *characteristic) {
+    g_assert(service != NULL);
+    g_assert(characteristic != NULL);
+
+    service->characteristics = g_list_remove(service->characteristics, characteristic);
+}
+
 GList *binc_service_get_characteristics(const Service *service) {
     g_assert(service != NULL);
     return service->characteristics;
@@ -30,4 +30,8 @@ void binc_service_free(Service *service);
 
 void binc_service_add_characteristic(Service *service, Characteristic *characteristic);
 
+void binc_service_remove_characteristic(Service *service, Characteristic *characteristic);
+
+const char *binc_service_get_path(const Service *service);
+
 #endif //BINC_SERVICE_INTERNAL_H
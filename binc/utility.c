@@ -40,6 +40,17 @@ GString *g_byte_array_as_hex(const GByteArray *byteArray) {
     return result;
 }
 
+GString *g_bytes_as_hex(GBytes *bytes) {
+    gsize size = 0;
+    const guint8 *data = g_bytes_get_data(bytes, &size);
+    guint hexLength = (guint) size * 2;
+    GString *result = g_string_sized_new(hexLength + 1);
+    bytes_to_hex(result->str, data, hexLength);
+    result->str[hexLength] = 0;
+    result->len = (gsize) hexLength;
+    return result;
+}
+
 GList *g_variant_string_array_to_list(GVariant *value) {
     g_assert(value != NULL);
     g_assert(g_str_equal(g_variant_get_type_string(value), "as"));
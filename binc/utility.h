@@ -32,6 +32,8 @@ extern "C" {
 
 GString *g_byte_array_as_hex(const GByteArray *byteArray);
 
+GString *g_bytes_as_hex(GBytes *bytes);
+
 GList *g_variant_string_array_to_list(GVariant *value);
 
 float binc_round_with_precision(float value, guint8 precision);
@@ -0,0 +1,116 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+/*
+ * Updates the manufacturer data of a registered advertisement faster than the update interval and reports
+ * how long it takes before a change is handed to Bluez, and how many changes were combined.
+ */
+
+#include <glib.h>
+#include "adapter.h"
+#include "advertisement.h"
+#include "logger.h"
+
+#define TAG "Benchmark"
+#define MANUFACTURER_ID 0xFFFF
+#define UPDATE_COUNT 1000
+#define UPDATE_PERIOD_MS 5
+#define UPDATE_INTERVAL_MS 50
+
+static GMainLoop *loop = NULL;
+static Adapter *default_adapter = NULL;
+static Advertisement *advertisement = NULL;
+static guint32 counter = 0;
+static gint64 setter_us = 0;
+
+static void set_counter(guint32 value) {
+    guint8 bytes[] = {(guint8) (value >> 24), (guint8) (value >> 16), (guint8) (value >> 8), (guint8) value};
+    GByteArray *byteArray = g_byte_array_sized_new(sizeof(bytes));
+    g_byte_array_append(byteArray, bytes, sizeof(bytes));
+
+    gint64 start = g_get_monotonic_time();
+    binc_advertisement_set_manufacturer_data(advertisement, MANUFACTURER_ID, byteArray);
+    setter_us += g_get_monotonic_time() - start;
+
+    g_byte_array_free(byteArray, TRUE);
+}
+
+static gboolean report(gpointer data) {
+    AdvertisementUpdateStats stats;
+    binc_advertisement_get_update_stats(advertisement, &stats);
+
+    log_info(TAG, "%lu updates, %lu sent to Bluez, %lu coalesced",
+             (unsigned long) stats.updates, (unsigned long) stats.emitted, (unsigned long) stats.coalesced);
+    log_info(TAG, "update latency mean %ld us, max %ld us, setter %.2f us/call",
+             (long) stats.mean_latency_us, (long) stats.max_latency_us,
+             (double) setter_us / (double) UPDATE_COUNT);
+
+    binc_adapter_stop_advertising(default_adapter, advertisement);
+    binc_advertisement_free(advertisement);
+    binc_adapter_free(default_adapter);
+    g_main_loop_quit(loop);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean update(gpointer data) {
+    set_counter(++counter);
+    if (counter < UPDATE_COUNT) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    // Give the last combined update time to go out
+    g_timeout_add(2 * UPDATE_INTERVAL_MS, report, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean start_updates(gpointer data) {
+    g_timeout_add(UPDATE_PERIOD_MS, update, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+int main(void) {
+    GDBusConnection *dbusConnection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, NULL);
+    loop = g_main_loop_new(NULL, FALSE);
+    log_set_level(LOG_INFO);
+
+    default_adapter = binc_adapter_get_default(dbusConnection);
+    if (default_adapter == NULL) {
+        log_error(TAG, "no default adapter found");
+        return 1;
+    }
+
+    advertisement = binc_advertisement_create();
+    binc_advertisement_set_local_name(advertisement, "BINC");
+    binc_advertisement_set_update_interval(advertisement, UPDATE_INTERVAL_MS);
+    set_counter(counter);
+    binc_adapter_start_advertising(default_adapter, advertisement);
+
+    // Wait for Bluez to pick up the advertisement before changing it
+    g_timeout_add_seconds(1, start_updates, NULL);
+    g_main_loop_run(loop);
+
+    g_main_loop_unref(loop);
+    g_dbus_connection_close_sync(dbusConnection, NULL, NULL);
+    g_object_unref(dbusConnection);
+    return 0;
+}
@@ -75,37 +75,28 @@ void on_notification_state_changed(Device *device, Characteristic *characteristi
     log_debug(TAG, "<%s> notifying %s", uuid, binc_characteristic_is_notifying(characteristic) ? "true" : "false");
 }
 
-void on_notify(Device *device, Characteristic *characteristic, const GByteArray *byteArray) {
-    const char *uuid = binc_characteristic_get_uuid(characteristic);
-    Parser *parser = parser_create(byteArray, LITTLE_ENDIAN);
-    parser_set_offset(parser, 1);
-    if (g_str_equal(uuid, TEMPERATURE_CHAR_UUID)) {
-        double temperature = parser_get_float(parser);
-        log_debug(TAG, "temperature %.1f", temperature);
-    }
-    parser_free(parser);
+void on_temperature_notify(Characteristic *characteristic, const GByteArray *byteArray, void *decoded,
+                           void *user_data) {
+    const TemperatureMeasurement *measurement = (const TemperatureMeasurement *) decoded;
+    if (measurement == NULL) return;
+
+    log_debug(TAG, "temperature %.1f %s", measurement->temperature, measurement->fahrenheit ? "F" : "C");
 }
 
-void on_read(Device *device, Characteristic *characteristic, const GByteArray *byteArray, const GError *error) {
-    const char *uuid = binc_characteristic_get_uuid(characteristic);
+void on_dis_string_read(Characteristic *characteristic, const GByteArray *byteArray, void *decoded,
+                        const GError *error, void *user_data) {
+    const char *label = (const char *) user_data;
     if (error != NULL) {
-        log_debug(TAG, "failed to read '%s' (error %d: %s)", uuid, error->code, error->message);
+        log_debug(TAG, "failed to read '%s' (error %d: %s)", label, error->code, error->message);
         return;
     }
 
     if (byteArray == NULL) return;
 
-    Parser *parser = parser_create(byteArray, LITTLE_ENDIAN);
-    if (g_str_equal(uuid, DIS_MANUFACTURER_CHAR)) {
-        GString *manufacturer = parser_get_string(parser);
-        log_debug(TAG, "manufacturer = %s", manufacturer->str);
-        g_string_free(manufacturer, TRUE);
-    } else if (g_str_equal(uuid, DIS_MODEL_CHAR)) {
-        GString *model = parser_get_string(parser);
-        log_debug(TAG, "model = %s", model->str);
-        g_string_free(model, TRUE);
-    }
-    parser_free(parser);
+    Parser parser;
+    parser_init(&parser, byteArray->data, byteArray->len, LITTLE_ENDIAN);
+    ParserStringView value = parser_get_string_view(&parser);
+    log_debug(TAG, "%s = %.*s", label, (int) value.length, value.data);
 }
 
 void on_write(Device *device, Characteristic *characteristic, const GByteArray *byteArray, const GError *error) {
@@ -114,18 +105,35 @@ void on_write(Device *device, Characteristic *characteristic, const GByteArray *
 
 void on_desc_read(Device *device, Descriptor *descriptor, const GByteArray *byteArray, const GError *error) {
     log_debug(TAG, "on descriptor read");
-    Parser *parser = parser_create(byteArray, LITTLE_ENDIAN);
-    GString *parsed_string = parser_get_string(parser);
-    log_debug(TAG, "CUD %s", parsed_string->str);
-    parser_free(parser);
+    if (byteArray == NULL) return;
+
+    Parser parser;
+    parser_init(&parser, byteArray->data, byteArray->len, LITTLE_ENDIAN);
+    ParserStringView cud = parser_get_string_view(&parser);
+    log_debug(TAG, "CUD %.*s", (int) cud.length, cud.data);
 }
 
 void on_services_resolved(Device *device) {
     log_debug(TAG, "'%s' services resolved", binc_device_get_name(device));
 
-    binc_device_read_char(device, DIS_SERVICE, DIS_MANUFACTURER_CHAR);
-    binc_device_read_char(device, DIS_SERVICE, DIS_MODEL_CHAR);
-    binc_device_start_notify(device, HTS_SERVICE_UUID, TEMPERATURE_CHAR_UUID);
+    Characteristic *manufacturer = binc_device_get_characteristic(device, DIS_SERVICE, DIS_MANUFACTURER_CHAR);
+    if (manufacturer != NULL) {
+        binc_characteristic_set_read_handler(manufacturer, &on_dis_string_read, "manufacturer");
+        binc_characteristic_read(manufacturer);
+    }
+
+    Characteristic *model = binc_device_get_characteristic(device, DIS_SERVICE, DIS_MODEL_CHAR);
+    if (model != NULL) {
+        binc_characteristic_set_read_handler(model, &on_dis_string_read, "model");
+        binc_characteristic_read(model);
+    }
+
+    Characteristic *temperature = binc_device_get_characteristic(device, HTS_SERVICE_UUID, TEMPERATURE_CHAR_UUID);
+    if (temperature != NULL) {
+        binc_characteristic_use_standard_decoder(temperature);
+        binc_characteristic_set_notify_handler(temperature, &on_temperature_notify, NULL);
+        binc_characteristic_start_notify(temperature);
+    }
     binc_device_read_desc(device, HTS_SERVICE_UUID, TEMPERATURE_CHAR_UUID, CUD_CHAR);
 }
 
@@ -153,9 +161,7 @@ void on_scan_result(Adapter *adapter, Device *device) {
     binc_device_set_connection_state_change_cb(device, &on_connection_state_changed);
     binc_device_set_services_resolved_cb(device, &on_services_resolved);
     binc_device_set_bonding_state_changed_cb(device, &on_bonding_state_changed);
-    binc_device_set_read_char_cb(device, &on_read);
     binc_device_set_write_char_cb(device, &on_write);
-    binc_device_set_notify_char_cb(device, &on_notify);
     binc_device_set_notify_state_cb(device, &on_notification_state_changed);
     binc_device_set_read_desc_cb(device, &on_desc_read);
     binc_device_connect(device);
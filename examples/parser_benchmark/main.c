@@ -0,0 +1,120 @@
+/*
+ *   Copyright (c) 2022 Martijn van Welie
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ *
+ */
+
+/*
+ * Compares decoding sample arrays with the scalar parser getters against the bulk array functions.
+ * Packets are sized like typical ECG/accelerometer notifications.
+ */
+
+#include <glib.h>
+#include <math.h>
+#include "logger.h"
+#include "parser.h"
+
+#define TAG "Benchmark"
+#define SAMPLES_PER_PACKET 120
+#define ITERATIONS 200000
+
+static const char *const format_names[] = {"sint16", "uint16", "uint24", "sfloat", "754half"};
+static const guint format_sizes[] = {2, 2, 3, 2, 2};
+
+static double scalar_get(Parser *parser, ParserSampleFormat format) {
+    switch (format) {
+        case PARSER_SAMPLE_SINT16:
+            return parser_get_sint16(parser);
+        case PARSER_SAMPLE_UINT16:
+            return parser_get_uint16(parser);
+        case PARSER_SAMPLE_UINT24:
+            return parser_get_uint24(parser);
+        case PARSER_SAMPLE_SFLOAT:
+            return parser_get_sfloat(parser);
+        default:
+            return parser_get_754half(parser);
+    }
+}
+
+static gboolean verify(const guint8 *packet, guint length, ParserSampleFormat format) {
+    float values[SAMPLES_PER_PACKET];
+    Parser scalar, bulk;
+    parser_init(&scalar, packet, length, LITTLE_ENDIAN);
+    parser_init(&bulk, packet, length, LITTLE_ENDIAN);
+    parser_get_float_array(&bulk, format, values, SAMPLES_PER_PACKET);
+
+    for (guint i = 0; i < SAMPLES_PER_PACKET; i++) {
+        float expected = (float) scalar_get(&scalar, format);
+        if (expected != values[i] && !(isnan(expected) && isnan(values[i]))) {
+            log_error(TAG, "%s sample %u differs: %f != %f", format_names[format], i, expected, values[i]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void benchmark(const guint8 *packet, guint length, ParserSampleFormat format) {
+    float values[SAMPLES_PER_PACKET];
+    volatile float sink = 0;
+
+    gint64 start = g_get_monotonic_time();
+    for (guint n = 0; n < ITERATIONS; n++) {
+        Parser parser;
+        parser_init(&parser, packet, length, LITTLE_ENDIAN);
+        for (guint i = 0; i < SAMPLES_PER_PACKET; i++) {
+            values[i] = (float) scalar_get(&parser, format);
+        }
+        sink += values[n % SAMPLES_PER_PACKET];
+    }
+    gint64 scalar_us = g_get_monotonic_time() - start;
+
+    start = g_get_monotonic_time();
+    for (guint n = 0; n < ITERATIONS; n++) {
+        Parser parser;
+        parser_init(&parser, packet, length, LITTLE_ENDIAN);
+        parser_get_float_array(&parser, format, values, SAMPLES_PER_PACKET);
+        sink += values[n % SAMPLES_PER_PACKET];
+    }
+    gint64 bulk_us = g_get_monotonic_time() - start;
+
+    double samples = (double) ITERATIONS * SAMPLES_PER_PACKET;
+    log_info(TAG, "%-8s scalar %6.2f ns/sample, bulk %6.2f ns/sample, speedup %.1fx",
+             format_names[format],
+             (double) scalar_us * 1000.0 / samples,
+             (double) bulk_us * 1000.0 / samples,
+             bulk_us > 0 ? (double) scalar_us / (double) bulk_us : 0.0);
+}
+
+int main(void) {
+    guint8 packet[SAMPLES_PER_PACKET * 3];
+    GRand *generator = g_rand_new_with_seed(42);
+    for (guint i = 0; i < sizeof(packet); i++) {
+        packet[i] = (guint8) g_rand_int_range(generator, 0, 256);
+    }
+    g_rand_free(generator);
+
+    log_set_level(LOG_INFO);
+    for (guint format = PARSER_SAMPLE_SINT16; format <= PARSER_SAMPLE_754HALF; format++) {
+        guint length = SAMPLES_PER_PACKET * format_sizes[format];
+        if (!verify(packet, length, (ParserSampleFormat) format)) return 1;
+        benchmark(packet, length, (ParserSampleFormat) format);
+    }
+    return 0;
+}
@@ -38,6 +38,14 @@
 #define TEMPERATURE_CHAR_UUID "00002a1c-0000-1000-8000-00805f9b34fb"
 #define CUD_CHAR "00002901-0000-1000-8000-00805f9b34fb"
 
+static const guint8 cud[] = "hello there";
+
+static const GattAttribute gatt_table[] = {
+        GATT_SERVICE(HTS_SERVICE_UUID),
+        GATT_CHARACTERISTIC(TEMPERATURE_CHAR_UUID, GATT_CHR_PROP_INDICATE | GATT_CHR_PROP_WRITE),
+        GATT_DESCRIPTOR_VALUE(CUD_CHAR, GATT_CHR_PROP_READ | GATT_CHR_PROP_WRITE, cud),
+};
+
 GMainLoop *loop = NULL;
 Adapter *default_adapter = NULL;
 Advertisement *advertisement = NULL;
@@ -205,23 +213,7 @@ int main(void) {
 
         // Start application
         app = binc_create_application(default_adapter);
-        binc_application_add_service(app, HTS_SERVICE_UUID);
-        binc_application_add_characteristic(
-                app,
-                HTS_SERVICE_UUID,
-                TEMPERATURE_CHAR_UUID,
-                GATT_CHR_PROP_INDICATE | GATT_CHR_PROP_WRITE);
-        binc_application_add_descriptor(
-                app,
-                HTS_SERVICE_UUID,
-                TEMPERATURE_CHAR_UUID,
-                CUD_CHAR,
-                GATT_CHR_PROP_READ | GATT_CHR_PROP_WRITE);
-
-        const guint8 cud[] = "hello there";
-        GByteArray *cudArray = g_byte_array_sized_new(sizeof(cud));
-        g_byte_array_append(cudArray, cud, sizeof(cud));
-        binc_application_set_desc_value(app, HTS_SERVICE_UUID, TEMPERATURE_CHAR_UUID, CUD_CHAR, cudArray);
+        binc_application_add_gatt_table(app, gatt_table, G_N_ELEMENTS(gatt_table), NULL, NULL);
 
         binc_application_set_char_read_cb(app, &on_local_char_read);
         binc_application_set_char_write_cb(app, &on_local_char_write);